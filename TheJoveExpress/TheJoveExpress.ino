@@ -4,7 +4,6 @@
 // #include "src/PinIO/Mcp23017Device.h"
 // #include "src/motor/TB6612Motor.h"
 // #include "src/wifi/TheTime.h"
-// #include <NimBLEDevice.h> //Designates BLE impl
 // #include "src/ble/TheBLE.h"
 // #include "mic.h"
 // #include "camera.h"
@@ -14,6 +13,7 @@
 #include "src/PinIO/I2CHardware.h"
 #include "src/PinIO/SPIHardware.h"
 #include "src/PinIO/SBJTask.h"
+#include "src/PinIO/SBJCpuGovernor.h"
 #include "src/wifi/TheWifi.h"
 #include "src/fs/TheSDCard.h"
 
@@ -52,9 +52,9 @@
 //   BCLK = D6
 //   LRCLK/WS = D7
 
-  const std::string serviceName = "The Jove Express";
+  constexpr const char* serviceName = "The Jove Express";
 // TheBLE _ble(_taskScheduler, serviceName);
-  TheWifi _wifi(serviceName.c_str());
+  TheWifi _wifi(serviceName);
 
 // using expander = Mcp23017Device<>;
 SPIHardware spi(D8, D9, D10);
@@ -63,6 +63,7 @@ TheSDCard sdcard;
 //SbjAudioPlayerEsp32S3 audio(D2, D6, D7);
 //ST7789Display<ST7789TraitsDft> display;
 LightingSubsystem<> lighting;
+SBJCpuGovernor<> governor;
 // struct MotorPins
 // {
 //   inline static constexpr PinIO<D3, GpioMode::PWMOut> MotorPwma{};
@@ -112,6 +113,7 @@ void setup()
   _wifi.begin();
 
   lighting.begin();
+  governor.begin();
 
   // mic::begin(_taskScheduler);
   // camera::begin(_taskScheduler);
@@ -133,5 +135,12 @@ void loop()
   //   Serial.println("audio play failed");
   // }
   // delay(10000);
+#if SBJTASK_STACK_PROFILE
+  static uint32_t lastStackReport = 0;
+  if (millis() - lastStackReport >= 30000) {
+    lastStackReport = millis();
+    SBJTask::printStackProfile();
+  }
+#endif
   SBJTask::loop();
 }
@@ -26,7 +26,7 @@ public:
   TrainDockSensor(Scheduler& scheduler, BLEServiceRunner& ble, Callback callback)
   : _detected(Docked::None)
   , _callback(callback)
-  , _sensedChar(ble, Traits::bleProperty, &_detected)
+  , _sensedChar(ble, Traits::bleProperty, _detected)
   , _task(scheduler, Traits::timingMS, this)
   {
   }
@@ -38,7 +38,7 @@ public:
 private:
   Docked _detected;
   Callback _callback;
-  IDBTCharacteristic _sensedChar;
+  IDBTValue<Docked> _sensedChar;
   TaskThunk _task;
 
   virtual void loop(Task&)
@@ -46,8 +46,9 @@ private:
     auto value = Traits::Pin::read();
     auto detected = value < 5 ? Docked::None : value < 20 ? Docked::Passive : Docked::Charging;
     if (detected != _detected) {
+      _detected = detected;
       if (_callback) _callback(detected);
-      _sensedChar.ble.writeValue((uint8_t)detected);
     }
+    _sensedChar.set(detected);
   }
 };
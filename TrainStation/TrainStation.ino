@@ -3,8 +3,13 @@
 #include <algorithm>
 
 #include "src/ble/BLEServiceRunner.h"
+#include "src/ble/BLETelemetry.h"
+#include "src/ble/BLECommandBatch.h"
+#include "src/ble/BLEEventLog.h"
 #include "src/display/MatrixR4Display.h"
 #include "src/rfid/RFIDBroadcaster.h"
+#include "src/rfid/TrainRegistry.h"
+#include "src/rfid/TrainTracker.h"
 #include "TrainDockSensor.h"
 
 struct KnownTrain {
@@ -14,42 +19,53 @@ struct KnownTrain {
 #include "config.h"
 
 constexpr size_t UnknownLogoIdx = 0;
-static std::array<KnownTrain, 10> _knownTrains;
-static size_t _knownTrainCount = std::min(_knownTrains.size(), config::knownTrains.size());
-static size_t _selectedTrainLogo = UnknownLogoIdx;
 static RFID::ID _lastId = {};
 
 Scheduler _runner;
+TrainRegistry<MatrixR4Value::Value> _knownTrains(_runner);
 BLEServiceRunner _ble(_runner, config::serviceName);
+BLETelemetry<> _telemetry(_runner, _ble);
+BLEEventLog<> _events(_runner, _ble);
+static_assert(std::tuple_size<RFID::Encoded>::value <= BLEEventLogTraitsDft::maxValue, "RFID passages would be truncated in the event log");
+BLECommandBatch<> _commands(_runner, _ble);
 
 static inline void bridgeMatrix(const MatrixR4Value::Value& edited) {
-  if (_selectedTrainLogo != UnknownLogoIdx) {
-    _knownTrains[_selectedTrainLogo].logo = edited;
-  }
-  else if (_knownTrainCount < _knownTrains.size()) {
-    _selectedTrainLogo = _knownTrainCount;
-    _knownTrains[_selectedTrainLogo].id = _lastId;
-    _knownTrains[_selectedTrainLogo].logo = edited;
-    _knownTrainCount++;
+  if (_lastId != RFID::ID{}) {
+    _knownTrains.set(_lastId, edited);
   }
 }
 
 MatrixR4Display<config::MatrixR4DTraits> _matrixR4(_runner, _ble, bridgeMatrix);
 
+static void bridgeEstimate(const TrainEstimate& estimate);
+TrainTracker<config::TrainTrackerTraits> _tracker(_ble, &bridgeEstimate);
+
 static inline void bridgeRFID(const RFID& detected) {
-  _lastId = detected._uuid;
-  _selectedTrainLogo = UnknownLogoIdx;
-  for (size_t i = UnknownLogoIdx + 1; i < _knownTrainCount; ++i) {
-    if (_knownTrains[i].id == _lastId) {
-	    _selectedTrainLogo = i;
-      break;
-    }
+  _tracker.detected(detected);
+  _lastId = {};
+  std::copy(detected._uuid.begin(), detected._uuid.begin() + detected._length, _lastId.begin());
+  if (detected._payload && !_knownTrains.find(_lastId)) {
+    Serial.print("Train: ");
+    Serial.println(detected._payload->name);
+    _knownTrains.set(_lastId, detected._payload->logo);
   }
-  _matrixR4.update(_knownTrains[_selectedTrainLogo].logo);
+  const MatrixR4Value::Value* logo = _knownTrains.find(_lastId);
+  _matrixR4.update(logo ? *logo : config::knownTrains[UnknownLogoIdx].logo);
 }
 
 RFIDBroadcaster<config::RFIDBroadcasterTraits> _rfidBroadcaster(_runner, _ble, &bridgeRFID);
-TrainDockSensor<config::TrainDockSensorTraits> _trainDockSensor(_runner, _ble, nullptr);
+
+static void bridgeEstimate(const TrainEstimate& estimate) {
+  if (estimate.nextReader == config::RFIDBroadcasterTraits::Number && estimate.eta10Ms != 0) {
+    _rfidBroadcaster.expect(estimate.eta10Ms * 10u);
+  }
+}
+
+static inline void bridgeDock(TrainDockSensor<config::TrainDockSensorTraits>::Docked) {
+  _rfidBroadcaster.wake();
+}
+
+TrainDockSensor<config::TrainDockSensorTraits> _trainDockSensor(_runner, _ble, &bridgeDock);
 
 constexpr int announceCount = 2;
 constexpr int announceTime = 500;
@@ -68,9 +84,17 @@ Task announceTask(announceTime, announceCount, &announce, &_runner);
 
 void setup()
 {
-  std::copy(config::knownTrains.data(), config::knownTrains.data() + _knownTrainCount, _knownTrains.data());
-  
   Serial.begin(115200);
+  if (!_knownTrains.begin()) {
+    for (size_t i = UnknownLogoIdx + 1; i < config::knownTrains.size(); ++i) {
+      if (config::knownTrains[i].id != RFID::ID{}) {
+        _knownTrains.set(config::knownTrains[i].id, config::knownTrains[i].logo);
+      }
+    }
+  }
+#if SBJ_BLE_LATENCY_PROBE
+  BLELatencyProbe::begin();
+#endif
   _ble.begin();
   _matrixR4.begin();
   _rfidBroadcaster.begin();
@@ -81,5 +105,12 @@ void setup()
 
 void loop()
 {
+#if SBJ_BLE_LATENCY_PROBE
+  static uint32_t lastLatencyReport = 0;
+  if (millis() - lastLatencyReport >= 30000) {
+    lastLatencyReport = millis();
+    BLELatencyProbe::print();
+  }
+#endif
   _runner.execute();
 }
@@ -6,6 +6,13 @@ inline constexpr const char* serviceName = "Train Station";
 using MatrixR4DTraits = MatrixR4DTraitsDft;
 using TrainDockSensorTraits = TrainDockSensorTraitsDft;
 using RFIDBroadcasterTraits = RFIDBroadcasterTraitsDft;
+// To let trains self-register from their stickers, opt in to reading the
+// tag payload in config.h (costs one READ per new tag):
+// struct RFIDBroadcasterTraits : RFIDBroadcasterTraitsDft
+// {
+//   static constexpr bool readPayload = true;
+// };
+using TrainTrackerTraits = TrainTrackerTraitsDft;
 
 inline constexpr std::array<KnownTrain, 3> knownTrains
 {
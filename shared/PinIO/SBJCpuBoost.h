@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ARDUINO_ARCH_ESP32) && __has_include("esp_pm.h")
+  #include "esp_pm.h"
+  #define SBJ_CPU_BOOST 1
+#else
+  #define SBJ_CPU_BOOST 0
+#endif
+
+// Holds the CPU at its maximum frequency (and out of light sleep) while in
+// scope. Use around latency or timing sensitive bursts: camera capture,
+// audio playback, bit-banged IR. No-op where esp_pm is unavailable.
+//
+// esp_pm locks are reference counted, so nested or concurrent boosts are fine.
+class SBJCpuBoost
+{
+public:
+  SBJCpuBoost() { acquire(); }
+  ~SBJCpuBoost() { release(); }
+
+  SBJCpuBoost(const SBJCpuBoost&) = delete;
+  SBJCpuBoost& operator=(const SBJCpuBoost&) = delete;
+
+  static inline void acquire()
+  {
+#if SBJ_CPU_BOOST
+    if (esp_pm_lock_handle_t h = lock()) esp_pm_lock_acquire(h);
+#endif
+  }
+
+  static inline void release()
+  {
+#if SBJ_CPU_BOOST
+    if (esp_pm_lock_handle_t h = lock()) esp_pm_lock_release(h);
+#endif
+  }
+
+private:
+#if SBJ_CPU_BOOST
+  static inline esp_pm_lock_handle_t lock()
+  {
+    static esp_pm_lock_handle_t handle = []{
+      esp_pm_lock_handle_t h = nullptr;
+      if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "sbj_boost", &h) != ESP_OK) h = nullptr;
+      return h;
+    }();
+    return handle;
+  }
+#endif
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "SBJTask.h"
+#include "SBJCpuBoost.h"
+
+#if SBJ_CPU_BOOST
+  #include "esp_idf_version.h"
+#endif
+
+/*
+Load-driven CPU clock for ESP32 targets.
+
+At idle the power manager is free to run at minMHz and drop into automatic
+light sleep between ticks. When the share of wall time spent inside SBJTask
+callbacks climbs past boostLoadPct the governor holds the max clock until
+load falls back under releaseLoadPct. Latency critical work does not wait
+for the governor: tasks with Schedule::boost, and SBJCpuBoost scopes, hold
+the max clock for their own duration.
+
+Light sleep also requires tickless idle (CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+in the core's sdkconfig; without it the clock still scales.
+*/
+struct SBJCpuGovernorTraitsDft
+{
+  static constexpr int      maxMHz         = 240;
+  static constexpr int      minMHz         = 80;
+  static constexpr bool     lightSleep     = true;
+  static constexpr uint32_t sampleMs       = 250;
+  static constexpr uint8_t  boostLoadPct   = 50;
+  static constexpr uint8_t  releaseLoadPct = 20;
+};
+
+template <typename Traits = SBJCpuGovernorTraitsDft>
+class SBJCpuGovernor
+{
+public:
+  static_assert(Traits::releaseLoadPct < Traits::boostLoadPct, "Governor needs hysteresis");
+
+  SBJCpuGovernor()
+  : _task("governor", this, GovernorTaskDesc{})
+  {
+  }
+
+  bool begin()
+  {
+#if SBJ_CPU_BOOST
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t cfg = {};
+#else
+    esp_pm_config_esp32s3_t cfg = {};
+#endif
+    cfg.max_freq_mhz = Traits::maxMHz;
+    cfg.min_freq_mhz = Traits::minMHz;
+    cfg.light_sleep_enable = Traits::lightSleep;
+    if (esp_pm_configure(&cfg) != ESP_OK)
+    {
+      Serial.println("Governor: esp_pm_configure failed (PM disabled in core?)");
+      return false;
+    }
+    _lastBusyUs = SBJTask::totalBusyMicros();
+    _lastWallUs = esp_timer_get_time();
+    _task.begin();
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Percent of wall time spent in task callbacks over the last sample.
+  uint8_t load() const { return _load; }
+  bool boosted() const { return _boosted; }
+
+private:
+  void tick()
+  {
+#if SBJ_CPU_BOOST
+    const uint32_t busy = SBJTask::totalBusyMicros();
+    const int64_t  wall = esp_timer_get_time();
+    const uint32_t busyDelta = busy - _lastBusyUs;
+    const int64_t  wallDelta = wall - _lastWallUs;
+    _lastBusyUs = busy;
+    _lastWallUs = wall;
+    if (wallDelta <= 0) return;
+
+    const int64_t pct = (static_cast<int64_t>(busyDelta) * 100) / wallDelta;
+    _load = pct > 100 ? 100 : static_cast<uint8_t>(pct);
+
+    if (!_boosted && _load >= Traits::boostLoadPct)
+    {
+      SBJCpuBoost::acquire();
+      _boosted = true;
+    }
+    else if (_boosted && _load <= Traits::releaseLoadPct)
+    {
+      SBJCpuBoost::release();
+      _boosted = false;
+    }
+#endif
+  }
+
+  struct GovernorTaskDesc
+  {
+    using Obj = SBJCpuGovernor;
+    static constexpr void (Obj::*Method)() = &Obj::tick;
+    static constexpr SBJTask::Schedule schedule{
+      Traits::sampleMs, FOREVER, 0,
+      2048, TaskPriority::Low, 0
+    };
+  };
+
+  uint32_t _lastBusyUs = 0;
+  int64_t  _lastWallUs = 0;
+  uint8_t  _load = 0;
+  bool     _boosted = false;
+
+  SBJTask _task;
+};
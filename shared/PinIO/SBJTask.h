@@ -3,10 +3,15 @@
 #include <Arduino.h>
 #include <stdint.h>
 #include <limits.h>
+#include <string.h>
+
+#include "SBJCpuBoost.h"
 
 #if defined(ARDUINO_ARCH_ESP32)
+  #include <atomic>
   #include "freertos/FreeRTOS.h"
   #include "freertos/task.h"
+  #include "esp_timer.h"
   #define SBJVTask 1
 #else
   #ifndef _TASK_LTS_POINTER
@@ -24,6 +29,31 @@
   using CoreID = int;
 #endif
 
+#if SBJVTask
+  // Stack profiling: build with SBJTASK_STACK_PROFILE=1, exercise the system,
+  // then call SBJTask::printStackProfile() and save the output as
+  // SBJTaskStacks.h next to the sketch. Production builds pick it up and
+  // replace each task's requested stackDepth with the tuned value.
+  #ifndef SBJTASK_STACK_PROFILE
+    #define SBJTASK_STACK_PROFILE 0
+  #endif
+  #ifndef SBJTASK_STACK_PROFILE_SLOTS
+    #define SBJTASK_STACK_PROFILE_SLOTS 16
+  #endif
+
+  struct SBJTaskStackDepth {
+    const char* name;
+    uint32_t    depth;
+  };
+
+  #if !SBJTASK_STACK_PROFILE && __has_include("../../SBJTaskStacks.h")
+    #include "../../SBJTaskStacks.h"
+    #define SBJTASK_HAS_STACK_TABLE 1
+  #else
+    #define SBJTASK_HAS_STACK_TABLE 0
+  #endif
+#endif
+
 enum class TaskPriority : uint8_t {
   Low    = 1,
   Medium = 2,
@@ -68,19 +98,22 @@ public:
     const uint32_t     stackDepth;
     const TaskPriority priority;
     const CoreID       coreId;
+    const bool         boost;   // hold max CPU clock while the callback runs
 
     constexpr Schedule(uint32_t intervalMs_   = 1,
                        int32_t iterations_    = kForever,
                        uint32_t startDelayMs_ = 0,
                        uint32_t stackDepth_   = 4096,
                        TaskPriority priority_ = TaskPriority::Low,
-                       CoreID coreId_         = 0)
+                       CoreID coreId_         = 0,
+                       bool boost_            = false)
     : intervalMs(intervalMs_)
     , iterations(iterations_)
     , startDelayMs(startDelayMs_)
     , stackDepth(stackDepth_)
     , priority(priority_)
     , coreId(coreId_)
+    , boost(boost_)
     {
 #ifndef NDEBUG
       if (intervalMs_ == 0) { /* invalid interval */ }
@@ -143,10 +176,12 @@ public:
   {
     if (begun()) return;
 #if SBJVTask
+    const char* name = _esp.name ? _esp.name : "SBJTask";
+    const uint32_t depth = stackDepthFor(name, _esp.stackDepth);
     BaseType_t ok = xTaskCreatePinnedToCore(
         _esp.entry,
-        _esp.name ? _esp.name : "SBJTask",
-        _esp.stackDepth,
+        name,
+        depth,
         this,
         _esp.priority,
         &_esp.handle,
@@ -154,12 +189,88 @@ public:
 
     if (ok == pdPASS) {
       _esp.begun = true;
+      trackStack(name, _esp.handle, depth);
     }
 #else
     _scheduler.task.enable();
 #endif
   }
 
+#if SBJVTask
+  // Microseconds spent inside this task's callback (wraps ~71 min).
+  inline uint32_t busyMicros() const
+  {
+    return _esp.busyUs.load(std::memory_order_relaxed);
+  }
+
+  // Microseconds spent inside all SBJTask callbacks (wraps ~71 min).
+  // Sample twice and subtract for load over a window.
+  static inline uint32_t totalBusyMicros()
+  {
+    return busyTotal().load(std::memory_order_relaxed);
+  }
+
+  // Stack depth to create a task with: the tuned value from SBJTaskStacks.h
+  // when one exists for this name, otherwise the requested depth.
+  // Units are whatever xTaskCreatePinnedToCore takes (bytes on ESP-IDF).
+  static inline uint32_t stackDepthFor(const char* name, uint32_t requested)
+  {
+#if SBJTASK_HAS_STACK_TABLE
+    for (const SBJTaskStackDepth& entry : kSBJTaskStackDepths) {
+      if (name && strcmp(entry.name, name) == 0) return entry.depth;
+    }
+#endif
+    (void)name;
+    return requested;
+  }
+
+  // Register a task for stack profiling. SBJTask does this itself;
+  // raw FreeRTOS tasks (audio player, etc.) call it after creation.
+  static inline void trackStack(const char* name, TaskHandle_t handle, uint32_t depth)
+  {
+#if SBJTASK_STACK_PROFILE
+    StackProfile& p = stackProfile();
+    if (!handle || p.count >= SBJTASK_STACK_PROFILE_SLOTS) return;
+    p.slots[p.count++] = StackSlot{ name, handle, depth, depth };
+#else
+    (void)name;
+    (void)handle;
+    (void)depth;
+#endif
+  }
+
+  // Emit a ready-to-save SBJTaskStacks.h. Each depth is the observed peak
+  // plus marginPct, rounded up to 256 and never below minDepth.
+  static inline void printStackProfile(Print& out = Serial,
+                                       uint8_t marginPct = 25,
+                                       uint32_t minDepth = 1024)
+  {
+#if SBJTASK_STACK_PROFILE
+    StackProfile& p = stackProfile();
+    out.println("// SBJTaskStacks.h - generated by SBJTask::printStackProfile()");
+    out.println("#pragma once");
+    out.println();
+    out.println("inline constexpr SBJTaskStackDepth kSBJTaskStackDepths[] = {");
+    for (uint8_t i = 0; i < p.count; ++i) {
+      StackSlot& slot = p.slots[i];
+      sampleStack(slot);
+      const uint32_t used = slot.depth - slot.minFree;
+      uint32_t tuned = used + (used * marginPct) / 100;
+      tuned = (tuned + 255u) & ~255u;
+      if (tuned < minDepth) tuned = minDepth;
+      if (tuned > slot.depth) tuned = slot.depth;
+      out.printf("  { \"%s\", %u }, // peak %u of %u\n",
+                 slot.name, (unsigned)tuned, (unsigned)used, (unsigned)slot.depth);
+    }
+    out.println("};");
+#else
+    (void)out;
+    (void)marginPct;
+    (void)minDepth;
+#endif
+  }
+#endif
+
   SBJTask(const SBJTask&) = delete;
   SBJTask& operator=(const SBJTask&) = delete;
   SBJTask(SBJTask&&) = delete;
@@ -167,6 +278,51 @@ public:
 
 private:
 #if SBJVTask
+#if SBJTASK_STACK_PROFILE
+  struct StackSlot {
+    const char*  name;
+    TaskHandle_t handle;   // cleared when the task deletes itself
+    uint32_t     depth;
+    uint32_t     minFree;
+  };
+
+  struct StackProfile {
+    StackSlot slots[SBJTASK_STACK_PROFILE_SLOTS];
+    uint8_t   count = 0;
+  };
+
+  static inline StackProfile& stackProfile()
+  {
+    static StackProfile p;
+    return p;
+  }
+
+  static inline void sampleStack(StackSlot& slot)
+  {
+    if (!slot.handle) return;
+    const uint32_t free = uxTaskGetStackHighWaterMark(slot.handle);
+    if (free < slot.minFree) slot.minFree = free;
+  }
+
+  // Called by one-shot tasks just before vTaskDelete so their peak survives.
+  static inline void retireStack(TaskHandle_t handle)
+  {
+    StackProfile& p = stackProfile();
+    for (uint8_t i = 0; i < p.count; ++i) {
+      if (p.slots[i].handle == handle) {
+        sampleStack(p.slots[i]);
+        p.slots[i].handle = nullptr;
+      }
+    }
+  }
+#endif
+
+  static inline std::atomic<uint32_t>& busyTotal()
+  {
+    static std::atomic<uint32_t> total{0};
+    return total;
+  }
+
   struct EspState {
     using InitFn = bool (*)(SBJTask*);
     using CallFn = void (*)(SBJTask*);
@@ -187,7 +343,9 @@ private:
     const int32_t        iterations;
     const TickType_t     intervalTicks;
     const TickType_t     startDelayTicks;
+    const bool           boost;
 
+    std::atomic<uint32_t> busyUs;
     bool                 begun;
     TaskHandle_t         handle;
 
@@ -214,6 +372,17 @@ private:
       (obj->*Method)();
     }
 
+    static inline void run(SBJTask* self)
+    {
+      if (self->_esp.boost) SBJCpuBoost::acquire();
+      const int64_t start = esp_timer_get_time();
+      self->_esp.callFn(self);
+      const uint32_t spent = static_cast<uint32_t>(esp_timer_get_time() - start);
+      if (self->_esp.boost) SBJCpuBoost::release();
+      self->_esp.busyUs.fetch_add(spent, std::memory_order_relaxed);
+      busyTotal().fetch_add(spent, std::memory_order_relaxed);
+    }
+
     static void entryThunk(void* pv)
     {
       SBJTask* self = static_cast<SBJTask*>(pv);
@@ -227,14 +396,14 @@ private:
 
       if (self->_esp.iterations == FOREVER) {
         for (;;) {
-          self->_esp.callFn(self);
+          run(self);
           if (self->_esp.intervalTicks == 0) taskYIELD();
           else vTaskDelay(self->_esp.intervalTicks);
         }
       } else {
         const int32_t iters = self->_esp.iterations;
         for (int32_t i = 0; i < iters; ++i) {
-          self->_esp.callFn(self);
+          run(self);
           if (i + 1 < iters) {
             if (self->_esp.intervalTicks == 0) taskYIELD();
             else vTaskDelay(self->_esp.intervalTicks);
@@ -242,6 +411,9 @@ private:
         }
       }
 
+#if SBJTASK_STACK_PROFILE
+      retireStack(xTaskGetCurrentTaskHandle());
+#endif
       vTaskDelete(nullptr);
     }
 
@@ -263,6 +435,8 @@ private:
     , iterations(s.iterations)
     , intervalTicks(pdMS_TO_TICKS(s.intervalMs))
     , startDelayTicks(pdMS_TO_TICKS(s.startDelayMs))
+    , boost(s.boost)
+    , busyUs(0)
     , begun(false)
     , handle(nullptr)
     {}
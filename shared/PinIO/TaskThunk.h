@@ -29,6 +29,9 @@ public:
 
   void enable() { task.enable(); }
   void disable() { task.disable(); }
+  // Takes effect from now: the next run is intervalMs away.
+  void setInterval(uint32_t intervalMs) { task.setInterval(intervalMs); }
+  uint32_t interval() { return task.getInterval(); }
 
 private:
   Task task;
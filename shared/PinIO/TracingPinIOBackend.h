@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DefaultPinIOBackend.h"
+
+// Observer for output writes made through TracingPinIOBackend.
+struct PinIOTrace
+{
+  using Hook = void (*)(uint8_t pin);
+  inline static Hook onWrite = nullptr;
+};
+
+// ============================================================================
+// TracingPinIOBackend
+// Wraps another backend and reports every digital/PWM write to PinIOTrace
+// after it reaches the pin. Everything else is the inner backend's.
+//
+// Usage:
+//   using Led = PinIO<5, GpioMode::DigitalOut, TracingPinIOBackend<>>;
+//   PinIOTrace::onWrite = [](uint8_t pin) { ... };
+// ============================================================================
+template <typename Inner = DefaultPinIOBackend>
+struct TracingPinIOBackend : Inner
+{
+  static void write_digital(uint8_t pin, GpioLevel v)
+  {
+    Inner::write_digital(pin, v);
+    if (PinIOTrace::onWrite) PinIOTrace::onWrite(pin);
+  }
+
+  static void write_pwm(uint8_t pin, GpioArchTypes::pwm_type v)
+  {
+    Inner::write_pwm(pin, v);
+    if (PinIOTrace::onWrite) PinIOTrace::onWrite(pin);
+  }
+};
@@ -1,85 +1,263 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
+#include <array>
 
 /*
-// Max bytes for a 64-bit ULEB128 / protobuf varint
-static constexpr size_t kMaxVarint64Bytes = 10;
-
-// Encodes value into buffer.
-// Returns number of bytes written (1..10).
-size_t encodeULEB128_u64(uint64_t value, uint8_t* buffer) {
-  size_t i = 0;
-  do {
-    uint8_t byte = static_cast<uint8_t>(value & 0x7FULL); // lower 7 bits
-    value >>= 7;
-    if (value != 0) byte |= 0x80;                         // continuation
-    buffer[i++] = byte;
-  } while (value != 0 && i < kMaxVarint64Bytes);
-
-  // For uint64_t, i will never exceed 10 with correct logic above.
-  return i;
-}
+ULEB128 / protobuf style varints, zigzag for signed values, and a delta
+encoded sample stream built on them. Header only, no allocation.
+
+Every function is bounded by the caller's buffer: encoders return the
+number of bytes written, or 0 (and write nothing useful) when the value
+does not fit; decoders return the number of bytes consumed, or 0 when the
+input is truncated, overflows the target width, or is overlong: more than
+kMaxBytes, or not minimal (a zero final byte after the first, e.g. 0x80 0x00).
+
+  uint8_t buf[ULEB128::kMaxBytes64];
+  size_t n = ULEB128::encodeU64(300, buf, sizeof(buf));  // n == 2
+  uint64_t v = 0;
+  size_t used = ULEB128::decodeU64(buf, n, v);            // used == 2, v == 300
+*/
+namespace ULEB128
+{
+  inline constexpr size_t kMaxBytes32 = 5;
+  inline constexpr size_t kMaxBytes64 = 10;
 
-// Decodes from buffer into 'value'.
-// Returns true on success and sets:
-//   - value
-//   - bytesConsumed (1..10)
-// Returns false if input is malformed or would overflow uint64_t.
-//
-// NOTE: You must ensure 'buffer' has at least 10 readable bytes OR stop earlier
-// based on your framing (length-delimited packet, etc.).
-bool decodeULEB128_u64(const uint8_t* buffer, size_t bufferLen,
-                       uint64_t& value, size_t& bytesConsumed) {
-  value = 0;
-  bytesConsumed = 0;
-
-  uint32_t shift = 0;
-
-  for (size_t i = 0; i < kMaxVarint64Bytes; ++i) {
-    if (i >= bufferLen) return false; // not enough data
-
-    uint8_t byte = buffer[i];
-    uint64_t slice = static_cast<uint64_t>(byte & 0x7F);
-
-    // Overflow check:
-    // - For shifts 0..63, we can place bits.
-    // - If shift == 63, only 1 bit could fit; but varints place 7 bits at a time.
-    // Practical protobuf rule: on the 10th byte (i==9), only the low 1 bit may be set
-    // (because 64 bits total).
-    if (shift >= 64) return false;
-
-    if (i == 9) {
-      // 10th byte: only bit0 is allowed (values 0 or 1), and continuation must be 0
-      if ((byte & 0xFE) != 0) return false;  // any bits beyond bit0 set => overflow
-      if ((byte & 0x80) != 0) return false;  // continuation on 10th byte is invalid
+  constexpr size_t sizeU64(uint64_t value)
+  {
+    size_t n = 1;
+    while (value >= 0x80)
+    {
+      value >>= 7;
+      ++n;
     }
+    return n;
+  }
 
-    value |= (slice << shift);
-    bytesConsumed = i + 1;
+  constexpr size_t encodeU64(uint64_t value, uint8_t* out, size_t capacity)
+  {
+    if (capacity < sizeU64(value)) return 0;
+    size_t i = 0;
+    do
+    {
+      uint8_t byte = static_cast<uint8_t>(value & 0x7F);
+      value >>= 7;
+      if (value != 0) byte |= 0x80;
+      out[i++] = byte;
+    } while (value != 0);
+    return i;
+  }
 
-    if ((byte & 0x80) == 0) {
-      return true; // finished
+  constexpr size_t encodeU32(uint32_t value, uint8_t* out, size_t capacity)
+  {
+    return encodeU64(value, out, capacity);
+  }
+
+  constexpr size_t decodeU64(const uint8_t* in, size_t length, uint64_t& value)
+  {
+    uint64_t result = 0;
+    for (size_t i = 0; i < kMaxBytes64 && i < length; ++i)
+    {
+      const uint8_t byte = in[i];
+      // 10th byte may only carry the top bit of a 64 bit value
+      if (i == kMaxBytes64 - 1 && (byte & 0xFE) != 0) return 0;
+      // a zero final byte after the first is a non-minimal encoding
+      if (i > 0 && byte == 0) return 0;
+      result |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+      if ((byte & 0x80) == 0)
+      {
+        value = result;
+        return i + 1;
+      }
     }
+    return 0;
+  }
 
-    shift += 7;
+  constexpr size_t decodeU32(const uint8_t* in, size_t length, uint32_t& value)
+  {
+    uint32_t result = 0;
+    for (size_t i = 0; i < kMaxBytes32 && i < length; ++i)
+    {
+      const uint8_t byte = in[i];
+      // 5th byte may only carry the top 4 bits of a 32 bit value
+      if (i == kMaxBytes32 - 1 && (byte & 0xF0) != 0) return 0;
+      // a zero final byte after the first is a non-minimal encoding
+      if (i > 0 && byte == 0) return 0;
+      result |= static_cast<uint32_t>(byte & 0x7F) << (7 * i);
+      if ((byte & 0x80) == 0)
+      {
+        value = result;
+        return i + 1;
+      }
+    }
+    return 0;
   }
 
-  // If we consumed 10 bytes and still had continuation, it's malformed.
-  return false;
-}
-*/
-/*
-uint8_t buf[10];
-uint64_t original = 300ULL;
+  static_assert([] { const uint8_t in[] = { 0xAC, 0x02 }; uint64_t v = 0; return decodeU64(in, 2, v) == 2 && v == 300; }(),
+                "decodeU64 of a minimal encoding");
+  static_assert([] { const uint8_t in[] = { 0x80, 0x00 }; uint64_t v = 0; return decodeU64(in, 2, v); }() == 0,
+                "decodeU64 rejects a non-minimal encoding");
+  static_assert([] { const uint8_t in[] = { 0x00 }; uint32_t v = 1; return decodeU32(in, 1, v) == 1 && v == 0; }(),
+                "a single zero byte is the minimal encoding of 0");
+  static_assert([] { const uint8_t in[] = { 0xFF, 0x80, 0x00 }; uint32_t v = 0; return decodeU32(in, 3, v); }() == 0,
+                "decodeU32 rejects a non-minimal encoding");
+
+  // Zigzag maps small magnitudes of either sign to small unsigned values:
+  // 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...
+  constexpr uint64_t zigzag64(int64_t v)
+  {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+  }
+
+  constexpr int64_t unzigzag64(uint64_t v)
+  {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+  }
+
+  constexpr uint32_t zigzag32(int32_t v)
+  {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+  }
+
+  constexpr int32_t unzigzag32(uint32_t v)
+  {
+    return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+  }
+
+  constexpr size_t encodeS64(int64_t value, uint8_t* out, size_t capacity)
+  {
+    return encodeU64(zigzag64(value), out, capacity);
+  }
+
+  constexpr size_t encodeS32(int32_t value, uint8_t* out, size_t capacity)
+  {
+    return encodeU64(zigzag32(value), out, capacity);
+  }
+
+  constexpr size_t decodeS64(const uint8_t* in, size_t length, int64_t& value)
+  {
+    uint64_t raw = 0;
+    const size_t n = decodeU64(in, length, raw);
+    if (n) value = unzigzag64(raw);
+    return n;
+  }
+
+  constexpr size_t decodeS32(const uint8_t* in, size_t length, int32_t& value)
+  {
+    uint32_t raw = 0;
+    const size_t n = decodeU32(in, length, raw);
+    if (n) value = unzigzag32(raw);
+    return n;
+  }
+
+  /*
+  Delta encoded time series. Each sample is the timestamp delta (unsigned)
+  followed by one zigzag delta per channel, all varints. A slowly changing
+  lux or accel channel sampled at a steady rate costs 1-2 bytes per field
+  instead of 4. The first sample after reset() is relative to zero so every
+  buffer decodes on its own.
+  */
+  template <size_t Channels>
+  class DeltaWriter
+  {
+  public:
+    using Sample = std::array<int32_t, Channels>;
+    static constexpr size_t kMaxSampleBytes = kMaxBytes32 * (Channels + 1);
+
+    DeltaWriter(uint8_t* buffer, size_t capacity)
+    : _buffer(buffer)
+    , _capacity(capacity)
+    {
+    }
+
+    // Appends one sample; returns false and leaves the stream intact if it does not fit.
+    bool append(uint32_t timestamp, const Sample& values)
+    {
+      uint8_t scratch[kMaxSampleBytes] = {};
+      size_t n = encodeU32(timestamp - _lastTimestamp, scratch, sizeof(scratch));
+      for (size_t c = 0; c < Channels; ++c)
+      {
+        const int32_t delta = static_cast<int32_t>(
+          static_cast<uint32_t>(values[c]) - static_cast<uint32_t>(_last[c]));
+        n += encodeS32(delta, scratch + n, sizeof(scratch) - n);
+      }
+      if (_size + n > _capacity) return false;
+      for (size_t i = 0; i < n; ++i) _buffer[_size + i] = scratch[i];
+      _size += n;
+      _lastTimestamp = timestamp;
+      _last = values;
+      ++_count;
+      return true;
+    }
+
+    void reset()
+    {
+      _size = 0;
+      _count = 0;
+      _lastTimestamp = 0;
+      _last = Sample{};
+    }
+
+    const uint8_t* data() const { return _buffer; }
+    size_t size() const { return _size; }
+    size_t count() const { return _count; }
+
+  private:
+    uint8_t* _buffer;
+    size_t   _capacity;
+    size_t   _size = 0;
+    size_t   _count = 0;
+    uint32_t _lastTimestamp = 0;
+    Sample   _last{};
+  };
+
+  template <size_t Channels>
+  class DeltaReader
+  {
+  public:
+    using Sample = std::array<int32_t, Channels>;
 
-size_t n = encodeULEB128_u64(original, buf);
+    DeltaReader(const uint8_t* buffer, size_t length)
+    : _buffer(buffer)
+    , _length(length)
+    {
+    }
+
+    // Returns false at the end of the stream or on malformed input.
+    bool next(uint32_t& timestamp, Sample& values)
+    {
+      size_t pos = _pos;
+      uint32_t dt = 0;
+      size_t n = decodeU32(_buffer + pos, _length - pos, dt);
+      if (!n) return false;
+      pos += n;
+      Sample next = _last;
+      for (size_t c = 0; c < Channels; ++c)
+      {
+        int32_t delta = 0;
+        n = decodeS32(_buffer + pos, _length - pos, delta);
+        if (!n) return false;
+        pos += n;
+        next[c] = static_cast<int32_t>(static_cast<uint32_t>(_last[c]) + static_cast<uint32_t>(delta));
+      }
+      _pos = pos;
+      _lastTimestamp += dt;
+      _last = next;
+      timestamp = _lastTimestamp;
+      values = next;
+      return true;
+    }
+
+  private:
+    const uint8_t* _buffer;
+    size_t   _length;
+    size_t   _pos = 0;
+    uint32_t _lastTimestamp = 0;
+    Sample   _last{};
+  };
+}
 
-uint64_t decoded = 0;
-size_t consumed = 0;
-bool ok = decodeULEB128_u64(buf, n, decoded, consumed);
- */
- 
 //#include <EEPROM.h>
 //const int _epromIdxFirstRun = 0;
 //bool _firstRun = true;
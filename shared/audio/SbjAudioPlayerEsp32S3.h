@@ -13,6 +13,9 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 
+#include "../PinIO/SBJTask.h"
+#include "../PinIO/SBJCpuBoost.h"
+
 // NOTE:
 // - This file is written to compile under typical Arduino-ESP32 C++17 settings.
 // - If you're using the XIAO ESP32S3 Sense *built-in* SD slot, you may need SD_MMC instead of SD.
@@ -84,8 +87,11 @@ public:
       static_cast<SbjAudioPlayerEsp32S3*>(self)->taskLoop_();
     };
 
-    BaseType_t ok = xTaskCreatePinnedToCore(thunk, name, stackWords, this, prio, &task_, core);
-    return ok == pdPASS;
+    const uint32_t depth = SBJTask::stackDepthFor(name, stackWords);
+    BaseType_t ok = xTaskCreatePinnedToCore(thunk, name, depth, this, prio, &task_, core);
+    if (ok != pdPASS) return false;
+    SBJTask::trackStack(name, task_, depth);
+    return true;
   }
 
 private:
@@ -239,6 +245,7 @@ private:
     if (!parseWav_(f, w)) { f.close(); return; }
     if (w.fmt != 1 || w.bits != 16 || (w.ch != 1 && w.ch != 2)) { f.close(); return; }
 
+    SBJCpuBoost boost;
     i2sStart_(w.sr);
     f.seek(w.dataOff);
 
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+BLE backend selection. ArduinoBLE (UNO R4 etc.) is polled from a scheduler
+task; NimBLE-Arduino 2.x (ESP32) is event driven, writes arrive on the
+NimBLE host task. NimBLE is used on ESP32 when installed; define
+SBJ_BLE_NIMBLE to 0 or 1 before any BLE include to force a choice.
+*/
+#ifndef SBJ_BLE_NIMBLE
+  #if defined(ARDUINO_ARCH_ESP32) && __has_include(<NimBLEDevice.h>)
+    #define SBJ_BLE_NIMBLE 1
+  #else
+    #define SBJ_BLE_NIMBLE 0
+  #endif
+#endif
+
+#if SBJ_BLE_NIMBLE
+  #include <NimBLEDevice.h>
+
+  // ArduinoBLE property bits, the same as the GATT characteristic properties.
+  enum : uint8_t
+  {
+    BLERead                 = 0x02,
+    BLEWriteWithoutResponse = 0x04,
+    BLENotify               = 0x10,
+  };
+
+  using BLECharacteristicEventHandler = void (*)(NimBLECharacteristic* characteristic);
+#elif __has_include(<ArduinoBLE.h>)
+  #include <ArduinoBLE.h>
+#else
+  #error "No supported BLE backend found. Install ArduinoBLE (UNO R4 etc.) or NimBLE-Arduino (ESP32)."
+#endif
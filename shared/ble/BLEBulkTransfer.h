@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "IDBTCharacteristic.h"
+
+/*
+Chunked bulk transfer (logos, config, short audio clips) into a sink such
+as a file on TheSDCard. Two characteristics:
+
+  control  "00030001"  write + notify, commands in, status out
+  data     "00030002"  write without response, [u16 seq][payload]
+
+Commands (client -> station), little endian:
+  0x01 START  [flags][u32 size][u32 crc32][name...]   flags bit0 = resume
+  0x02 END                                            verify and commit
+  0x03 ABORT                                          discard
+  0x04 QUERY                                          resend status
+
+Status notify (station -> client):
+  [u8 status][u16 next seq][u32 offset][u8 window][u8 max chunk]
+
+Flow:
+  START is answered with Ready and the offset to send from (non-zero when
+  a resume found a partial file). The client streams data packets, seq
+  counting up from the reported next seq, each carrying the bytes that
+  follow the previous one, and keeps at most `window` packets unacked.
+  The station acks every window/2 packets. A packet with an unexpected
+  seq is dropped and answered once with Gap; the client rewinds to the
+  reported seq/offset. A client that hears nothing for a while sends
+  QUERY. After the last byte the client sends END and gets Done or
+  CrcError (CRC-32/IEEE over the whole object); after CrcError start
+  again without the resume flag.
+
+The link is held in BLELinkProfile::Bulk while a transfer is active. A
+disconnect aborts the transfer, keeping the bytes accepted so far in the
+sink for a resume.
+
+Writes to the sink are batched through a staging buffer sized for one SD
+sector so the card sees whole blocks, not 20-244 byte fragments.
+*/
+struct BLEBulkTransferTraitsDft
+{
+  static constexpr const char* controlProperty = "00030001";
+  static constexpr const char* dataProperty    = "00030002";
+  static constexpr uint8_t window       = 16;   // packets in flight
+  static constexpr size_t  maxChunk     = 242;  // ATT_MTU 247 - 3 - seq
+  static constexpr size_t  stagingBytes = 512;  // one SD sector
+  static constexpr size_t  maxName      = 48;
+};
+
+// Destination of a transfer. Calls arrive on the BLE polling task.
+class BLEBulkSink
+{
+public:
+  virtual ~BLEBulkSink() = default;
+
+  // Prepare name for size bytes. Returns the bytes already held when
+  // resuming (0 for a fresh start), or -1 to refuse.
+  virtual int32_t open(const char* name, uint32_t size, bool resume) = 0;
+
+  // Append at the current end.
+  virtual bool write(const uint8_t* data, size_t length) = 0;
+
+  // Read back held bytes so a resume can rebuild the CRC. Sinks that
+  // cannot read return 0 and the transfer restarts from zero.
+  virtual size_t read(uint32_t offset, uint8_t* data, size_t length) { return 0; }
+
+  // Finish; commit only when the CRC matched.
+  virtual bool close(bool commit) = 0;
+};
+
+namespace BLEBulkDetail
+{
+  // CRC-32/IEEE, reflected, nibble table: 64 bytes of flash.
+  inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length)
+  {
+    static constexpr uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+      0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i)
+    {
+      crc ^= data[i];
+      crc = (crc >> 4) ^ table[crc & 0x0F];
+      crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+  }
+
+  inline uint32_t readU32(const uint8_t* p)
+  {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+  }
+}
+
+template <typename Traits = BLEBulkTransferTraitsDft>
+class BLEBulkTransfer : private BLEDisconnectListener
+{
+public:
+  enum class Op : uint8_t { Start = 0x01, End = 0x02, Abort = 0x03, Query = 0x04 };
+  enum class Status : uint8_t { Ready = 0, Done = 1, CrcError = 2, Refused = 3, IoError = 4, Idle = 5, Gap = 6 };
+
+  static constexpr size_t StatusBytes = 9;
+  static constexpr size_t SeqBytes = 2;
+
+  struct ControlDesc
+  {
+    using Obj = BLEBulkTransfer;
+    using Value = std::array<uint8_t, 10 + Traits::maxName>;
+    static constexpr const char* property = Traits::controlProperty;
+    static constexpr bool notify = true;
+    static constexpr bool telemetry = false;
+    static constexpr void (Obj::*Method)(const uint8_t*, size_t) = &Obj::onControl;
+  };
+
+  struct DataDesc
+  {
+    using Obj = BLEBulkTransfer;
+    using Value = std::array<uint8_t, SeqBytes + Traits::maxChunk>;
+    static constexpr const char* property = Traits::dataProperty;
+    static constexpr bool notify = false;
+    static constexpr void (Obj::*Method)(const uint8_t*, size_t) = &Obj::onData;
+  };
+
+  BLEBulkTransfer(BLEServiceRunner& ble, BLEBulkSink& sink)
+  : _runner(ble)
+  , _sink(sink)
+  , _controlChar(ble, this, &_controlValue, ControlDesc{})
+  , _dataChar(ble, this, static_cast<const typename DataDesc::Value*>(nullptr), DataDesc{})
+  {
+    ble.addDisconnectListener(*this);
+  }
+
+  bool active() const { return _active; }
+  uint32_t received() const { return _offset; }
+  uint32_t expected() const { return _size; }
+
+private:
+  BLEServiceRunner& _runner;
+  BLEBulkSink& _sink;
+  typename ControlDesc::Value _controlValue{};
+  IDBTCharacteristic _controlChar;
+  IDBTCharacteristic _dataChar;
+
+  std::array<uint8_t, Traits::stagingBytes> _staging{};
+  size_t   _staged = 0;
+  uint32_t _size = 0;
+  uint32_t _crcExpected = 0;
+  uint32_t _crc = 0;
+  uint32_t _offset = 0;    // bytes accepted, staged or written
+  uint16_t _nextSeq = 0;
+  uint8_t  _sinceAck = 0;
+  bool     _active = false;
+  bool     _gapReported = false;
+  BLELinkProfile _restoreProfile = BLELinkProfile::Active;
+
+  // Keep what was accepted so the client can resume, then drop the transfer.
+  virtual void disconnected() override
+  {
+    if (!_active) return;
+    flush();
+    abort(Status::Idle);
+  }
+
+  void onControl(const uint8_t* data, size_t length)
+  {
+    if (length == 0) return;
+    switch (static_cast<Op>(data[0]))
+    {
+      case Op::Start: start(data + 1, length - 1); break;
+      case Op::End:   finish(); break;
+      case Op::Abort: abort(Status::Idle); break;
+      case Op::Query: notify(_active ? Status::Ready : Status::Idle); break;
+      default: break;
+    }
+  }
+
+  void onData(const uint8_t* data, size_t length)
+  {
+    if (!_active || length <= SeqBytes) return;
+    const uint16_t seq = uint16_t(data[0]) | uint16_t(data[1] << 8);
+    if (seq != _nextSeq)
+    {
+      if (!_gapReported)
+      {
+        _gapReported = true;
+        notify(Status::Gap);
+      }
+      return;
+    }
+    const uint8_t* payload = data + SeqBytes;
+    size_t count = length - SeqBytes;
+    if (_offset + count > _size)
+    {
+      abort(Status::IoError);
+      return;
+    }
+    _crc = BLEBulkDetail::crc32Update(_crc, payload, count);
+    _offset += count;
+    ++_nextSeq;
+    _gapReported = false;
+
+    while (count > 0)
+    {
+      const size_t n = std::min(count, _staging.size() - _staged);
+      std::memcpy(_staging.data() + _staged, payload, n);
+      _staged += n;
+      payload += n;
+      count -= n;
+      if (_staged == _staging.size() && !flush())
+      {
+        abort(Status::IoError);
+        return;
+      }
+    }
+
+    if (++_sinceAck >= ackEvery())
+    {
+      notify(Status::Ready);
+    }
+  }
+
+  void start(const uint8_t* args, size_t length)
+  {
+    if (_active) abort(Status::Idle);
+    if (length < 9)
+    {
+      notify(Status::Refused);
+      return;
+    }
+    const bool resume = (args[0] & 0x01) != 0;
+    _size = BLEBulkDetail::readU32(args + 1);
+    _crcExpected = BLEBulkDetail::readU32(args + 5);
+
+    char name[Traits::maxName + 1] = {};
+    const size_t nameLength = std::min(length - 9, Traits::maxName);
+    std::memcpy(name, args + 9, nameLength);
+
+    int32_t held = _sink.open(name, _size, resume);
+    if (held < 0)
+    {
+      notify(Status::Refused);
+      return;
+    }
+    _crc = 0;
+    if (held > 0 && (static_cast<uint32_t>(held) > _size || !rebuildCrc(static_cast<uint32_t>(held))))
+    {
+      _sink.close(false);
+      held = _sink.open(name, _size, false);
+      if (held != 0)
+      {
+        notify(Status::Refused);
+        return;
+      }
+      _crc = 0;
+    }
+    _offset = static_cast<uint32_t>(held);
+    _staged = 0;
+    _nextSeq = 0;
+    _sinceAck = 0;
+    _gapReported = false;
+    setActive(true);
+    notify(Status::Ready);
+  }
+
+  void finish()
+  {
+    if (!_active)
+    {
+      notify(Status::Idle);
+      return;
+    }
+    if (_offset < _size)
+    {
+      notify(Status::Gap); // client still owes data
+      return;
+    }
+    if (!flush())
+    {
+      abort(Status::IoError);
+      return;
+    }
+    const bool ok = (_crc == _crcExpected);
+    setActive(false);
+    if (!_sink.close(ok))
+    {
+      notify(Status::IoError);
+      return;
+    }
+    notify(ok ? Status::Done : Status::CrcError);
+  }
+
+  void abort(Status status)
+  {
+    if (_active)
+    {
+      _sink.close(false);
+      setActive(false);
+    }
+    _staged = 0;
+    notify(status);
+  }
+
+  void setActive(bool active)
+  {
+    if (active == _active) return;
+    _active = active;
+    BLELinkPolicy& link = _runner.link();
+    if (active)
+    {
+      _restoreProfile = link.profile();
+      link.setProfile(BLELinkProfile::Bulk);
+    }
+    else
+    {
+      link.setProfile(_restoreProfile);
+    }
+  }
+
+  bool flush()
+  {
+    if (_staged == 0) return true;
+    const bool ok = _sink.write(_staging.data(), _staged);
+    _staged = 0;
+    return ok;
+  }
+
+  // CRC of the bytes a resumed sink already holds, read back in staging sized blocks.
+  bool rebuildCrc(uint32_t held)
+  {
+    for (uint32_t at = 0; at < held; )
+    {
+      const size_t want = std::min<size_t>(_staging.size(), held - at);
+      const size_t got = _sink.read(at, _staging.data(), want);
+      if (got != want) return false;
+      _crc = BLEBulkDetail::crc32Update(_crc, _staging.data(), got);
+      at += got;
+    }
+    return true;
+  }
+
+  static constexpr uint8_t ackEvery()
+  {
+    return Traits::window > 1 ? Traits::window / 2 : 1;
+  }
+
+  void notify(Status status)
+  {
+    _sinceAck = 0;
+    uint8_t out[StatusBytes] = {
+      static_cast<uint8_t>(status),
+      static_cast<uint8_t>(_nextSeq),
+      static_cast<uint8_t>(_nextSeq >> 8),
+      static_cast<uint8_t>(_offset),
+      static_cast<uint8_t>(_offset >> 8),
+      static_cast<uint8_t>(_offset >> 16),
+      static_cast<uint8_t>(_offset >> 24),
+      Traits::window,
+      static_cast<uint8_t>(Traits::maxChunk) };
+    _controlChar.writeRaw(out, sizeof(out));
+  }
+};
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <strings.h>
+
+#include "BLEBackend.h"
+#include "../PinIO/TaskThunk.h"
+
+/*
+Central role next to the peripheral service: keeps a small pool of
+persistent connections to remote hubs (a Circuit Cube per train, Nordic
+UART service) so the station can drive several trains.
+
+- Free slots scan for the service and connect the first new hub seen;
+  slots can be pinned to an address to keep a hub in a fixed slot.
+- The write characteristic is discovered once per connection and kept,
+  so a command is a straight write without response, no UUID lookup.
+- send() queues per hub; each tick writes at most one command to every
+  connected hub, round robin, so hubs fill their own connection events in
+  parallel and one busy hub cannot starve the others. A full queue drops
+  its oldest command: for throttle and light levels the newest wins.
+
+Command latency is bounded by queueDepth * intervalMs plus one connection
+interval. Connecting blocks the scheduler for the duration of the
+ArduinoBLE connect and discovery, which only happens while a slot is free.
+BLE.poll() is left to the BLEServiceRunner task.
+*/
+struct BLECentralPoolTraitsDft
+{
+  static constexpr const char* serviceUuid = "6e400001-b5a3-f393-e0a9-e50e24dcca9e";
+  static constexpr const char* writeUuid   = "6e400002-b5a3-f393-e0a9-e50e24dcca9e";
+  static constexpr size_t   maxPeers    = 3;    // ArduinoBLE ATT_MAX_PEERS on R4
+  static constexpr size_t   queueDepth  = 4;
+  static constexpr size_t   maxCommand  = 20;   // ATT_MTU 23 payload
+  static constexpr uint32_t intervalMs  = 10;
+  static constexpr uint32_t rescanMs    = 5000; // pause between scans while a slot is free
+};
+
+template <typename Traits = BLECentralPoolTraitsDft>
+class BLECentralPool : ScheduledRunner
+{
+public:
+  static_assert(!SBJ_BLE_NIMBLE, "BLECentralPool uses the ArduinoBLE central API");
+
+  static constexpr size_t AddressLength = 17; // "aa:bb:cc:dd:ee:ff"
+
+  BLECentralPool(Scheduler& scheduler)
+  : _task(scheduler, Traits::intervalMs, this, false)
+  {
+  }
+
+  // Call after the BLE stack has begun.
+  void begin()
+  {
+    _task.enable();
+  }
+
+  // Reserve slot for the hub at address; other hubs never take it.
+  void pin(size_t slot, const char* address)
+  {
+    if (slot >= Traits::maxPeers) return;
+    std::strncpy(_peers[slot].pinned, address, AddressLength);
+    _peers[slot].pinned[AddressLength] = '\0';
+  }
+
+  bool connected(size_t slot) const
+  {
+    return slot < Traits::maxPeers && _peers[slot].ready;
+  }
+
+  // Connected slot's address, or "" when the slot is free.
+  const char* address(size_t slot) const
+  {
+    return slot < Traits::maxPeers ? _peers[slot].address : "";
+  }
+
+  bool send(size_t slot, const uint8_t* data, size_t length)
+  {
+    if (slot >= Traits::maxPeers || length == 0 || length > Traits::maxCommand) return false;
+    Peer& p = _peers[slot];
+    if (!p.ready) return false;
+    if (p.queued == Traits::queueDepth)
+    {
+      p.head = (p.head + 1) % Traits::queueDepth;
+      --p.queued;
+    }
+    Command& c = p.queue[(p.head + p.queued) % Traits::queueDepth];
+    std::memcpy(c.data.data(), data, length);
+    c.length = static_cast<uint8_t>(length);
+    ++p.queued;
+    return true;
+  }
+
+  bool send(size_t slot, const char* text)
+  {
+    return send(slot, reinterpret_cast<const uint8_t*>(text), std::strlen(text));
+  }
+
+private:
+  struct Command
+  {
+    std::array<uint8_t, Traits::maxCommand> data;
+    uint8_t length;
+  };
+
+  struct Peer
+  {
+    BLEDevice device;
+    BLECharacteristic write;
+    char address[AddressLength + 1] = {};
+    char pinned[AddressLength + 1] = {};
+    std::array<Command, Traits::queueDepth> queue{};
+    size_t head = 0;
+    size_t queued = 0;
+    bool ready = false;
+  };
+
+  std::array<Peer, Traits::maxPeers> _peers{};
+  TaskThunk _task;
+  uint32_t _lastScanMs = 0;
+  bool _scanning = false;
+  bool _everScanned = false;
+
+  virtual void loop(Task&) override
+  {
+    dropLost();
+    if (freeSlots() > 0) discover();
+    drain();
+  }
+
+  void dropLost()
+  {
+    for (Peer& p : _peers)
+    {
+      if (p.ready && !p.device.connected())
+      {
+        Serial.print("Hub lost: ");
+        Serial.println(p.address);
+        p.ready = false;
+        p.queued = 0;
+        p.address[0] = '\0';
+      }
+    }
+  }
+
+  size_t freeSlots() const
+  {
+    size_t n = 0;
+    for (const Peer& p : _peers) n += p.ready ? 0 : 1;
+    return n;
+  }
+
+  void discover()
+  {
+    const uint32_t now = millis();
+    if (!_scanning)
+    {
+      if (_everScanned && now - _lastScanMs < Traits::rescanMs) return;
+      _everScanned = true;
+      _lastScanMs = now;
+      _scanning = BLE.scanForUuid(Traits::serviceUuid) == 1;
+      return;
+    }
+
+    BLEDevice found = BLE.available();
+    if (!found)
+    {
+      if (now - _lastScanMs >= Traits::rescanMs)
+      {
+        BLE.stopScan();
+        _scanning = false;
+        _lastScanMs = now;
+      }
+      return;
+    }
+
+    const String address = found.address();
+    const int slot = slotFor(address.c_str());
+    if (slot < 0) return;
+
+    BLE.stopScan();
+    _scanning = false;
+    _lastScanMs = now;
+    connect(_peers[slot], found, address.c_str());
+  }
+
+  // Free slot for a newly seen hub: its pinned slot first, then any unpinned one.
+  int slotFor(const char* address) const
+  {
+    int unpinned = -1;
+    for (size_t i = 0; i < Traits::maxPeers; ++i)
+    {
+      const Peer& p = _peers[i];
+      if (p.ready && strcasecmp(p.address, address) == 0) return -1;
+      if (p.pinned[0] != '\0')
+      {
+        if (!p.ready && strcasecmp(p.pinned, address) == 0) return static_cast<int>(i);
+      }
+      else if (!p.ready && unpinned < 0)
+      {
+        unpinned = static_cast<int>(i);
+      }
+    }
+    return unpinned;
+  }
+
+  void connect(Peer& p, BLEDevice& device, const char* address)
+  {
+    if (!device.connect()) return;
+    if (!device.discoverService(Traits::serviceUuid))
+    {
+      device.disconnect();
+      return;
+    }
+    BLECharacteristic write = device.characteristic(Traits::writeUuid);
+    if (!write || !write.canWrite())
+    {
+      device.disconnect();
+      return;
+    }
+    p.device = device;
+    p.write = write;
+    std::strncpy(p.address, address, AddressLength);
+    p.address[AddressLength] = '\0';
+    p.head = 0;
+    p.queued = 0;
+    p.ready = true;
+    Serial.print("Hub connected: ");
+    Serial.println(p.address);
+  }
+
+  void drain()
+  {
+    for (Peer& p : _peers)
+    {
+      if (!p.ready || p.queued == 0) continue;
+      const Command& c = p.queue[p.head];
+      p.write.writeValue(c.data.data(), c.length, false);
+      p.head = (p.head + 1) % Traits::queueDepth;
+      --p.queued;
+    }
+  }
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#include "../PinIO/TaskThunk.h"
+#include "IDBTCharacteristic.h"
+#include "BLEWriteRouter.h"
+
+/*
+One characteristic carrying a batch of writes to any routed property, so a
+scene ("dim lights, horn, ramp motor") costs one write instead of several.
+
+Write (little endian):
+  u8  sequence
+  per command:
+    u32 property key (the 8 hex characters of the property id)
+    u8  length
+    u8  value[length]
+
+The whole batch is validated first (framing, every key routed) and then
+applied in one scheduler pass, in order, through BLEWriteRouter::dispatch,
+exactly as if each property had been written on its own characteristic.
+Nothing is applied if any command is bad.
+
+Ack notify:
+  u8 sequence, u8 status, u8 count (commands applied, or index of the bad one)
+*/
+struct BLECommandBatchTraitsDft
+{
+  static constexpr const char* bleProperty = "00020001";
+  static constexpr size_t maxBytes = 244; // one write at ATT_MTU 247
+};
+
+template <typename Traits = BLECommandBatchTraitsDft>
+class BLECommandBatch : ScheduledRunner
+{
+public:
+  enum class Status : uint8_t { Applied = 0, Malformed = 1, UnknownKey = 2, Busy = 3 };
+
+  static constexpr size_t HeaderBytes = 1;
+  static constexpr size_t CommandHeaderBytes = 5;
+
+  struct BatchDesc
+  {
+    using Obj = BLECommandBatch;
+    using Value = std::array<uint8_t, Traits::maxBytes>;
+    static constexpr const char* property = Traits::bleProperty;
+    static constexpr bool notify = true;
+    static constexpr bool telemetry = false;
+    static constexpr void (Obj::*Method)(const uint8_t*, size_t) = &Obj::receive;
+  };
+
+  BLECommandBatch(Scheduler& scheduler, BLEServiceRunner& ble)
+  : _batchChar(ble, this, static_cast<const typename BatchDesc::Value*>(nullptr), BatchDesc{})
+  , _task(scheduler, 0, this, false)
+  {
+  }
+
+private:
+  typename BatchDesc::Value _batch{};
+  size_t _length = 0;
+  std::atomic<bool> _pending{false};
+  IDBTCharacteristic _batchChar;
+  TaskThunk _task;
+
+  void receive(const uint8_t* data, size_t length)
+  {
+    if (length < HeaderBytes) return;
+    const uint8_t seq = data[0];
+    if (length > _batch.size())
+    {
+      ack(seq, Status::Malformed, 0);
+      return;
+    }
+    if (_pending.load())
+    {
+      ack(seq, Status::Busy, 0);
+      return;
+    }
+    uint8_t count = 0;
+    const Status status = validate(data, length, count);
+    if (status != Status::Applied)
+    {
+      ack(seq, status, count);
+      return;
+    }
+    std::memcpy(_batch.data(), data, length);
+    _length = length;
+    _pending.store(true);
+    SBJ_LATENCY_DEFERRED();
+    _task.enable();
+  }
+
+  Status validate(const uint8_t* data, size_t length, uint8_t& count) const
+  {
+    count = 0;
+    for (size_t at = HeaderBytes; at < length; ++count)
+    {
+      if (at + CommandHeaderBytes > length) return Status::Malformed;
+      const uint8_t* cmd = data + at;
+      const size_t valueLength = cmd[4];
+      if (at + CommandHeaderBytes + valueLength > length) return Status::Malformed;
+      const uint32_t key = readKey(cmd);
+      if (key == _batchChar.key() || !BLEWriteRouter::contains(key)) return Status::UnknownKey;
+      at += CommandHeaderBytes + valueLength;
+    }
+    return Status::Applied;
+  }
+
+  virtual void loop(Task&) override
+  {
+    _task.disable();
+    if (!_pending.load()) return;
+    SBJ_LATENCY_DISPATCHED();
+
+    uint8_t count = 0;
+    for (size_t at = HeaderBytes; at < _length; ++count)
+    {
+      const uint8_t* cmd = _batch.data() + at;
+      const size_t valueLength = cmd[4];
+      BLEWriteRouter::dispatch(readKey(cmd), cmd + CommandHeaderBytes, valueLength);
+      at += CommandHeaderBytes + valueLength;
+    }
+    const uint8_t seq = _batch[0];
+    _pending.store(false);
+    ack(seq, Status::Applied, count);
+  }
+
+  void ack(uint8_t seq, Status status, uint8_t count)
+  {
+    const uint8_t out[3] = { seq, static_cast<uint8_t>(status), count };
+    _batchChar.writeRaw(out, sizeof(out));
+  }
+
+  static uint32_t readKey(const uint8_t* p)
+  {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+  }
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+// Told when the central drops the link. Listeners chain off the service
+// runner and are called before the link policy resets, from the BLE
+// polling task (ArduinoBLE) or the NimBLE host task.
+class BLEDisconnectListener
+{
+public:
+  virtual ~BLEDisconnectListener() = default;
+
+  virtual void disconnected() = 0;
+
+  BLEDisconnectListener* nextListener = nullptr;
+};
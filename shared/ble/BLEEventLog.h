@@ -0,0 +1,243 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#include "../PinIO/TaskThunk.h"
+#include "../ULEB128.h"
+#include "IDBTCharacteristic.h"
+#include "BLETelemetrySink.h"
+#include "BLEWriteLock.h"
+
+/*
+Bounded in-RAM event history with backfill, so nothing notified while the
+phone was away (RFID passages, dock changes, lux, faults) is lost.
+
+The log is a telemetry sink of the runner and records whatever reaches
+that hook: every IDBTCharacteristic::writeValue (not writeRaw) once the
+log is constructed, whichever characteristic it comes from. record() adds
+events that have no characteristic. Each record gets a sequence number
+and millis() timestamp; the oldest are overwritten once capacity is
+reached. Records may arrive on the NimBLE host task; the ring is shared
+with the backfill task under a BLEWriteLock.
+
+Backfill: write u32 "since" (little endian) to the log characteristic;
+records from that sequence (or the oldest kept) are streamed back as
+notifications on the same characteristic:
+
+  u8      version
+  u8      flags: bit0 end of backfill, bit1 gap (records before first seq were lost),
+                 bit2 split (the value of the last record continues in the next frame),
+                 bit3 continued (the frame opens with the rest of record first seq)
+  uleb128 sequence of the first record; records in a frame are consecutive
+  [continued] u8 value[rest], up to the length given with the record header
+  per record:
+    uleb128 ms since the previous record (absolute for the first header)
+    u32     property key
+    u8      length
+    u8      value[length], cut short when split
+
+A frame with the end flag carries the records up to the newest; the client
+keeps the sequence after the last complete record as "since" for the next
+reconnect. A gap drops any half received record.
+
+Frames follow ATT_MTU - 3 and stay at payloadBytes when the MTU is not
+reported (ArduinoBLE, which also truncates notifications to that size).
+Records larger than a frame are split rather than refused; a record
+header always fits a 20 byte frame.
+*/
+struct BLEEventLogTraitsDft
+{
+  static constexpr const char* bleProperty = "00010003";
+  static constexpr size_t   capacity     = 64;  // records
+  static constexpr size_t   maxValue     = 20;  // bytes kept per record, RFID::Encoded is 19
+  static constexpr uint32_t intervalMs   = 20;  // one frame per interval while backfilling
+  static constexpr size_t   payloadBytes = 20;  // ATT_MTU 23 until the link reports more
+};
+
+template <typename Traits = BLEEventLogTraitsDft>
+class BLEEventLog : public BLETelemetrySink, ScheduledRunner
+{
+public:
+  static constexpr uint8_t Version = 2;
+  static constexpr size_t MaxPayload = 244;
+  static constexpr uint8_t FlagEnd = 0x01;
+  static constexpr uint8_t FlagGap = 0x02;
+  static constexpr uint8_t FlagSplit = 0x04;
+  static constexpr uint8_t FlagContinued = 0x08;
+
+  struct RequestDesc
+  {
+    using Obj = BLEEventLog;
+    using Value = std::array<uint8_t, MaxPayload>;
+    static constexpr const char* property = Traits::bleProperty;
+    static constexpr bool notify = true;
+    static constexpr bool telemetry = false;
+    static constexpr void (Obj::*Method)(const uint8_t*, size_t) = &Obj::request;
+  };
+
+  BLEEventLog(Scheduler& scheduler, BLEServiceRunner& ble)
+  : _runner(ble)
+  , _logChar(ble, this, static_cast<const typename RequestDesc::Value*>(nullptr), RequestDesc{})
+  , _task(scheduler, Traits::intervalMs, this, false)
+  {
+    ble.addTelemetrySink(*this);
+  }
+
+  // Log an event that has no characteristic, e.g. a fault code.
+  void record(uint32_t key, const void* data, size_t length)
+  {
+    BLEWriteLock::Guard guard(_lock);
+    Record& r = _records[_nextSeq % Traits::capacity];
+    r.ms = millis();
+    r.key = key;
+    r.length = static_cast<uint8_t>(length < Traits::maxValue ? length : Traits::maxValue);
+    std::memcpy(r.data.data(), data, r.length);
+    ++_nextSeq;
+  }
+
+  uint32_t nextSeq() const { return _nextSeq; }
+  uint32_t oldestSeq() const { return _nextSeq > Traits::capacity ? _nextSeq - Traits::capacity : 0; }
+
+  virtual void attach(uint32_t, size_t) override {}
+
+  virtual void publish(uint32_t key, const void* data, size_t length) override
+  {
+    record(key, data, length);
+  }
+
+private:
+  struct Record
+  {
+    uint32_t ms;
+    uint32_t key;
+    uint8_t  length;
+    std::array<uint8_t, Traits::maxValue> data;
+  };
+
+  BLEServiceRunner& _runner;
+  IDBTCharacteristic _logChar;
+  TaskThunk _task;
+  std::array<Record, Traits::capacity> _records{};
+  uint32_t _nextSeq = 0;
+
+  std::atomic<uint32_t> _requested{0};
+  std::atomic<bool> _pending{false};
+  uint32_t _sendSeq = 0;
+  uint8_t  _sendOffset = 0; // value bytes of record _sendSeq already sent
+  bool _streaming = false;
+  bool _gap = false;
+  std::array<uint8_t, MaxPayload> _frame{};
+  BLEWriteLock _lock;
+
+  static constexpr size_t HeaderBytes = ULEB128::kMaxBytes32 + 5;
+  // Version, flags, first seq, one record header and a value byte.
+  static_assert(2 + ULEB128::kMaxBytes32 + HeaderBytes < Traits::payloadBytes, "payloadBytes too small for a record header");
+  static_assert(Traits::maxValue <= 0xFF, "record length is one byte");
+
+  static size_t encodeHeader(const Record& r, uint32_t deltaMs, uint8_t* out)
+  {
+    size_t n = ULEB128::encodeU32(deltaMs, out, ULEB128::kMaxBytes32);
+    out[n++] = static_cast<uint8_t>(r.key);
+    out[n++] = static_cast<uint8_t>(r.key >> 8);
+    out[n++] = static_cast<uint8_t>(r.key >> 16);
+    out[n++] = static_cast<uint8_t>(r.key >> 24);
+    out[n++] = r.length;
+    return n;
+  }
+
+  void request(const uint8_t* data, size_t length)
+  {
+    if (length < 4) return;
+    _requested.store(uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24));
+    _pending.store(true);
+    SBJ_LATENCY_DEFERRED();
+    _task.enable();
+  }
+
+  size_t payloadLimit() const
+  {
+    const uint16_t mtu = _runner.link().info().mtu;
+    const size_t limit = mtu > 3 ? mtu - 3 : Traits::payloadBytes;
+    return limit < MaxPayload ? limit : MaxPayload;
+  }
+
+  virtual void loop(Task&) override
+  {
+    if (_pending.exchange(false))
+    {
+      SBJ_LATENCY_DISPATCHED();
+      const uint32_t since = _requested.load();
+      _sendSeq = since > _nextSeq ? _nextSeq : since;
+      _sendOffset = 0;
+      _gap = false;
+      _streaming = true;
+    }
+    if (!_streaming)
+    {
+      _task.disable();
+      return;
+    }
+    const size_t used = fill(payloadLimit());
+    _logChar.writeRaw(_frame.data(), used);
+  }
+
+  // Build the next frame from _sendSeq on and advance past what it holds;
+  // returns its size. The lock is not held across the notify.
+  size_t fill(size_t limit)
+  {
+    BLEWriteLock::Guard guard(_lock);
+    if (_sendSeq < oldestSeq())
+    {
+      _sendSeq = oldestSeq(); // overwritten before it could be sent
+      _sendOffset = 0;
+      _gap = true;
+    }
+
+    uint8_t flags = _gap ? FlagGap : 0;
+    size_t used = 2;
+    used += ULEB128::encodeU32(_sendSeq, _frame.data() + used, limit - used);
+    uint32_t seq = _sendSeq;
+    if (_sendOffset > 0)
+    {
+      flags |= FlagContinued;
+      used += append(_records[seq % Traits::capacity], used, limit);
+      if (_sendOffset == 0) ++seq;
+    }
+    bool first = true;
+    uint32_t lastMs = 0;
+    for (; _sendOffset == 0 && seq < _nextSeq; ++seq)
+    {
+      const Record& r = _records[seq % Traits::capacity];
+      uint8_t header[HeaderBytes];
+      const size_t h = encodeHeader(r, first ? r.ms : r.ms - lastMs, header);
+      if (used + h > limit || (used + h == limit && r.length > 0)) break;
+      std::memcpy(_frame.data() + used, header, h);
+      used += h + append(r, used + h, limit);
+      first = false;
+      lastMs = r.ms;
+      if (_sendOffset > 0) break; // split, seq stays on this record
+    }
+    if (_sendOffset > 0) flags |= FlagSplit;
+
+    const bool end = (seq == _nextSeq);
+    _frame[0] = Version;
+    _frame[1] = flags | (end ? FlagEnd : 0);
+    _sendSeq = seq;
+    _gap = false;
+    if (end) _streaming = false;
+    return used;
+  }
+
+  // Copy as much of r's unsent value as fits; leaves _sendOffset at 0 once
+  // the record is complete.
+  size_t append(const Record& r, size_t used, size_t limit)
+  {
+    const size_t rest = r.length - _sendOffset;
+    const size_t n = rest < limit - used ? rest : limit - used;
+    std::memcpy(_frame.data() + used, r.data.data() + _sendOffset, n);
+    _sendOffset = n == rest ? 0 : static_cast<uint8_t>(_sendOffset + n);
+    return n;
+  }
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+#include <array>
+
+#include "../PinIO/TracingPinIOBackend.h"
+
+#ifndef SBJ_BLE_LATENCY_PROBE
+  #define SBJ_BLE_LATENCY_PROBE 0
+#endif
+
+/*
+Write-to-actuation latency, measured on the device. Each routed BLE write
+is timestamped where the device first sees it: the NimBLE write callback,
+or on ArduinoBLE the start of the BLE.poll() call that delivered it, so
+time waiting inside the poll is included. From there we record
+
+  Event      until the write handler returns
+  Dispatch   for writes whose handler defers the work to a scheduler task
+             (command batch, event log request, matrix animation), until
+             that task runs it
+  Actuation  until the first output change after the write: a PinIO write
+             through TracingPinIOBackend, or an explicit mark in the
+             lighting, LEGO PF and matrix update paths
+
+into log2 microsecond histograms (bucket b holds [2^b, 2^(b+1)) us).
+Enable with -DSBJ_BLE_LATENCY_PROBE=1; the hooks compile away otherwise.
+The radio side (phone to stack) is not visible here; add one connection
+interval for the end to end figure. tests/host/BLELatencyProbeTest.cpp
+drives the same hooks from a loopback client on the simulated clock.
+*/
+class BLELatencyProbe
+{
+public:
+  enum class Stage : uint8_t { Event = 0, Dispatch = 1, Actuation = 2 };
+  static constexpr size_t Stages = 3;
+  static constexpr size_t Buckets = 24; // up to ~16 s
+
+  struct Histogram
+  {
+    std::array<uint32_t, Buckets> counts{};
+    uint32_t samples = 0;
+    uint32_t maxUs = 0;
+
+    void add(uint32_t us)
+    {
+      size_t bucket = 0;
+      for (uint32_t v = us; v > 1 && bucket + 1 < Buckets; v >>= 1) ++bucket;
+      ++counts[bucket];
+      ++samples;
+      if (us > maxUs) maxUs = us;
+    }
+
+    // Upper bound of the bucket holding the given percentile, at most maxUs.
+    uint32_t percentileUs(uint8_t pct) const
+    {
+      if (samples == 0) return 0;
+      const uint32_t target = (static_cast<uint64_t>(samples) * pct + 99) / 100;
+      uint32_t seen = 0;
+      for (size_t b = 0; b < Buckets; ++b)
+      {
+        seen += counts[b];
+        if (seen >= target) return std::min((2u << b) - 1, maxUs);
+      }
+      return maxUs;
+    }
+  };
+
+  static void begin()
+  {
+    PinIOTrace::onWrite = [](uint8_t) { actuated(); };
+  }
+
+  // ArduinoBLE delivers writes from inside BLE.poll().
+  static void pollBegin()
+  {
+    state().pollUs = micros();
+    state().polling = true;
+  }
+
+  static void pollEnd()
+  {
+    state().polling = false;
+  }
+
+  static void event()
+  {
+    State& s = state();
+    s.eventUs = s.polling ? s.pollUs : micros();
+    s.pending = true;
+    s.inHandler = true;
+    s.dispatchPending = false;
+  }
+
+  // The handler queued its work for a scheduler task.
+  static void deferred()
+  {
+    State& s = state();
+    if (s.inHandler) s.dispatchPending = true;
+  }
+
+  static void handled()
+  {
+    State& s = state();
+    s.inHandler = false;
+    s.histograms[size_t(Stage::Event)].add(micros() - s.eventUs);
+  }
+
+  static void dispatched()
+  {
+    State& s = state();
+    if (!s.dispatchPending) return;
+    s.dispatchPending = false;
+    s.histograms[size_t(Stage::Dispatch)].add(micros() - s.eventUs);
+  }
+
+  static void actuated()
+  {
+    State& s = state();
+    if (!s.pending) return;
+    s.pending = false;
+    s.histograms[size_t(Stage::Actuation)].add(micros() - s.eventUs);
+  }
+
+  static const Histogram& histogram(Stage stage)
+  {
+    return state().histograms[size_t(stage)];
+  }
+
+  static void reset()
+  {
+    state() = State{};
+  }
+
+  static void print(Print& out = Serial)
+  {
+    static const char* const names[Stages] = { "event", "dispatch", "actuation" };
+    out.println("BLE latency (us): stage n p50 p90 p99 max");
+    for (size_t i = 0; i < Stages; ++i)
+    {
+      const Histogram& h = state().histograms[i];
+      out.print("  ");
+      out.print(names[i]);
+      out.print(" ");
+      out.print(h.samples);
+      out.print(" ");
+      out.print(h.percentileUs(50));
+      out.print(" ");
+      out.print(h.percentileUs(90));
+      out.print(" ");
+      out.print(h.percentileUs(99));
+      out.print(" ");
+      out.println(h.maxUs);
+    }
+  }
+
+private:
+  struct State
+  {
+    std::array<Histogram, Stages> histograms{};
+    uint32_t eventUs = 0;
+    uint32_t pollUs = 0;
+    bool polling = false;
+    bool inHandler = false;
+    bool pending = false;
+    bool dispatchPending = false;
+  };
+
+  static State& state()
+  {
+    static State s;
+    return s;
+  }
+};
+
+#if SBJ_BLE_LATENCY_PROBE
+  #define SBJ_LATENCY_POLL_BEGIN() BLELatencyProbe::pollBegin()
+  #define SBJ_LATENCY_POLL_END()   BLELatencyProbe::pollEnd()
+  #define SBJ_LATENCY_EVENT()      BLELatencyProbe::event()
+  #define SBJ_LATENCY_HANDLED()    BLELatencyProbe::handled()
+  #define SBJ_LATENCY_DEFERRED()   BLELatencyProbe::deferred()
+  #define SBJ_LATENCY_DISPATCHED() BLELatencyProbe::dispatched()
+  #define SBJ_LATENCY_ACTUATED()   BLELatencyProbe::actuated()
+#else
+  #define SBJ_LATENCY_POLL_BEGIN() do {} while (0)
+  #define SBJ_LATENCY_POLL_END()   do {} while (0)
+  #define SBJ_LATENCY_EVENT()      do {} while (0)
+  #define SBJ_LATENCY_HANDLED()    do {} while (0)
+  #define SBJ_LATENCY_DEFERRED()   do {} while (0)
+  #define SBJ_LATENCY_DISPATCHED() do {} while (0)
+  #define SBJ_LATENCY_ACTUATED()   do {} while (0)
+#endif
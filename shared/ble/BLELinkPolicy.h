@@ -0,0 +1,258 @@
+#pragma once
+
+#include <Arduino.h>
+#include <array>
+#include "BLEBackend.h"
+#include "BLEWriteRouter.h"
+
+#if SBJ_BLE_NIMBLE
+  #include "esp_timer.h"
+#endif
+
+/*
+Connection parameter policy for the peripheral. The central (phone) has
+the final say; we request what each profile wants and report what was
+negotiated.
+
+  Idle    long interval with slave latency, parked and saving power
+  Active  short interval, commands land within one 7.5-15 ms event
+  Bulk    shortest interval for BLEBulkTransfer
+
+A connection starts Active. Every routed write switches Idle back to
+Active straight from the write path and restarts a one-shot idle timer;
+when idleAfterMs pass without one the link drops to Idle. NimBLE runs
+that timer on esp_timer, ArduinoBLE checks the deadline after each
+BLE.poll() of the runner task it already has. Bulk is left alone until the transfer restores
+the previous profile. A disconnect puts the next connection back to
+Active whatever the last one was using.
+
+NimBLE applies a profile change to the live connection, switches to 2M PHY,
+enables data length extension and offers a 247 byte ATT MTU. ArduinoBLE
+only exposes the preferred connection interval, which the central reads
+on its next connection; PHY, DLE and MTU are left to the stack there, and
+the negotiated interval is not reported (info() keeps it at 0).
+*/
+enum class BLELinkProfile : uint8_t
+{
+  Idle = 0,
+  Active = 1,
+  Bulk = 2,
+};
+
+// Intervals in 1.25 ms units, timeout in 10 ms units (BLE spec units).
+struct BLELinkParams
+{
+  uint16_t minInterval;
+  uint16_t maxInterval;
+  uint16_t latency;
+  uint16_t timeout;
+};
+
+inline constexpr std::array<BLELinkParams, 3> bleLinkDefaults = {{
+  { 80, 160, 4, 600 },  // Idle: 100-200 ms, skip up to 4 events
+  {  6,  12, 0, 400 },  // Active: 7.5-15 ms
+  {  6,   6, 0, 400 },  // Bulk: 7.5 ms
+}};
+
+struct BLELinkInfo
+{
+  bool     connected = false;
+  uint16_t interval = 0;   // 1.25 ms units, 0 = unknown
+  uint16_t latency = 0;
+  uint16_t timeout = 0;    // 10 ms units
+  uint16_t mtu = 0;        // ATT MTU, 0 = unknown
+  uint8_t  txPhy = 1;      // 1 = 1M, 2 = 2M, 3 = coded
+  uint8_t  rxPhy = 1;
+
+  void printTo(Print& out) const
+  {
+    out.print("BT link: interval ");
+    if (interval == 0)
+    {
+      out.print("unknown");
+    }
+    else
+    {
+      out.print(interval * 5 / 4);
+      out.print(" ms, latency ");
+      out.print(latency);
+      out.print(", timeout ");
+      out.print(timeout * 10);
+      out.print(" ms");
+    }
+    out.print(", MTU ");
+    if (mtu == 0) out.print("unknown");
+    else out.print(mtu);
+    out.print(", PHY ");
+    out.print(txPhy);
+    out.print("/");
+    out.println(rxPhy);
+  }
+};
+
+class BLELinkPolicy
+{
+public:
+  static constexpr uint16_t PreferredMtu = 247;
+  static constexpr uint16_t DataLength = 251; // max LL payload with DLE
+  static constexpr uint32_t IdleAfterMs = 10000;
+
+  BLELinkProfile profile() const { return _profile; }
+  const BLELinkInfo& info() const { return _info; }
+
+  void setParams(BLELinkProfile profile, const BLELinkParams& params)
+  {
+    _params[static_cast<size_t>(profile)] = params;
+    if (profile == _profile) apply();
+  }
+
+  void setProfile(BLELinkProfile profile)
+  {
+    if (profile == _profile) return;
+    _profile = profile;
+    apply();
+    if (profile == BLELinkProfile::Active) armIdle();
+  }
+
+  // Takes effect from the next write.
+  void setIdleAfter(uint32_t ms) { _idleAfterMs = ms; }
+
+  // A write arrived: wake an idle link, or push the idle timeout back.
+  void activity()
+  {
+    if (!_info.connected) return;
+    if (_profile == BLELinkProfile::Idle) setProfile(BLELinkProfile::Active);
+    else if (_profile == BLELinkProfile::Active) armIdle();
+  }
+
+#if !SBJ_BLE_NIMBLE
+  // Idle deadline check; the runner calls it after each BLE.poll().
+  void poll(uint32_t now = millis())
+  {
+    if (_info.connected && _profile == BLELinkProfile::Active && int32_t(now - _idleAtMs) >= 0)
+    {
+      setProfile(BLELinkProfile::Idle);
+    }
+  }
+#endif
+
+  // Runner hooks.
+  void begin()
+  {
+    BLEWriteRouter::setActivity(&onWrite, this);
+#if SBJ_BLE_NIMBLE
+    if (!_idleTimer)
+    {
+      esp_timer_create_args_t args{};
+      args.callback = &onIdle;
+      args.arg = this;
+      args.name = "bleIdle";
+      esp_timer_create(&args, &_idleTimer);
+    }
+    NimBLEDevice::setMTU(PreferredMtu);
+    NimBLEDevice::setDefaultPhy(BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK);
+#endif
+    apply();
+  }
+
+  void disconnected()
+  {
+    _info = BLELinkInfo{};
+#if SBJ_BLE_NIMBLE
+    _handle = NoHandle;
+    if (_idleTimer) esp_timer_stop(_idleTimer);
+#endif
+    setProfile(BLELinkProfile::Active);
+  }
+
+#if SBJ_BLE_NIMBLE
+  void connected(NimBLEConnInfo& conn)
+  {
+    _handle = conn.getConnHandle();
+    _info.connected = true;
+    paramsUpdated(conn);
+    _info.mtu = conn.getMTU();
+    if (NimBLEServer* server = NimBLEDevice::getServer())
+    {
+      server->setDataLen(_handle, DataLength);
+      server->updatePhy(_handle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK, 0);
+    }
+    apply();
+    if (_profile == BLELinkProfile::Active) armIdle();
+  }
+
+  void paramsUpdated(NimBLEConnInfo& conn)
+  {
+    _info.interval = conn.getConnInterval();
+    _info.latency = conn.getConnLatency();
+    _info.timeout = conn.getConnTimeout();
+  }
+
+  void mtuChanged(uint16_t mtu) { _info.mtu = mtu; }
+
+  void phyUpdated(uint8_t txPhy, uint8_t rxPhy)
+  {
+    _info.txPhy = txPhy;
+    _info.rxPhy = rxPhy;
+  }
+#else
+  void connected()
+  {
+    _info.connected = true;
+    if (_profile == BLELinkProfile::Active) armIdle();
+  }
+#endif
+
+private:
+  std::array<BLELinkParams, 3> _params = bleLinkDefaults;
+  BLELinkProfile _profile = BLELinkProfile::Active;
+  BLELinkInfo _info;
+  uint32_t _idleAfterMs = IdleAfterMs;
+#if SBJ_BLE_NIMBLE
+  static constexpr uint16_t NoHandle = 0xFFFF;
+  uint16_t _handle = NoHandle;
+  esp_timer_handle_t _idleTimer = nullptr;
+#else
+  uint32_t _idleAtMs = 0;
+#endif
+
+  const BLELinkParams& params() const { return _params[static_cast<size_t>(_profile)]; }
+
+  static void onWrite(void* self) { static_cast<BLELinkPolicy*>(self)->activity(); }
+
+  // Restart the idle countdown from now.
+  void armIdle()
+  {
+    if (!_info.connected) return;
+#if SBJ_BLE_NIMBLE
+    if (!_idleTimer) return;
+    esp_timer_stop(_idleTimer);
+    esp_timer_start_once(_idleTimer, uint64_t(_idleAfterMs) * 1000);
+#else
+    _idleAtMs = millis() + _idleAfterMs;
+#endif
+  }
+
+#if SBJ_BLE_NIMBLE
+  // esp_timer task; a write since arming would have restarted the timer.
+  static void onIdle(void* arg)
+  {
+    BLELinkPolicy* self = static_cast<BLELinkPolicy*>(arg);
+    if (self->_info.connected && self->_profile == BLELinkProfile::Active) self->setProfile(BLELinkProfile::Idle);
+  }
+#endif
+
+  void apply()
+  {
+    const BLELinkParams& p = params();
+#if SBJ_BLE_NIMBLE
+    NimBLEServer* server = NimBLEDevice::getServer();
+    if (server && _handle != NoHandle)
+    {
+      server->updateConnParams(_handle, p.minInterval, p.maxInterval, p.latency, p.timeout);
+    }
+#else
+    BLE.setConnectionInterval(p.minInterval, p.maxInterval);
+#endif
+  }
+};
@@ -1,13 +1,24 @@
 #pragma once
 
-#include <ArduinoBLE.h>
+#include "BLEBackend.h"
+
+#if SBJ_BLE_NIMBLE
+
+#include "TheBLE.h"
+
+#else
+
 #include "BLEUUID.h"
+#include "BLETelemetrySink.h"
+#include "BLEDisconnectListener.h"
+#include "BLELinkPolicy.h"
+#include "BLELatencyProbe.h"
 #include "../PinIO/TaskThunk.h"
 
 class BLEServiceRunner
 {
 public:
-  BLEServiceRunner(Scheduler& scheduler, const std::string& serviceName, int pollMS = 100, const std::string& overrideId = "")
+  BLEServiceRunner(Scheduler& scheduler, const char* serviceName, int pollMS = 100, const char* overrideId = nullptr)
   : _name(serviceName)
   , _serviceId(makeUuidWithService(serviceName, overrideId))
   , _bleService(_serviceId.data())
@@ -22,6 +33,24 @@ public:
     _bleService.addCharacteristic(ble);
   }
 
+  // Sinks only see characteristics constructed after they are added.
+  void addTelemetrySink(BLETelemetrySink& sink)
+  {
+    sink.nextSink = _sinks;
+    _sinks = &sink;
+  }
+
+  BLETelemetrySink* telemetrySinks() const { return _sinks; }
+
+  void addDisconnectListener(BLEDisconnectListener& listener)
+  {
+    listener.nextListener = _listeners;
+    _listeners = &listener;
+  }
+
+  BLELinkPolicy& link() { return _link; }
+  const BLELinkPolicy& link() const { return _link; }
+
   void begin()
   {
     if (!BLE.begin())
@@ -29,7 +58,9 @@ public:
       Serial.println("Starting Bluetooth® Low Energy module failed!");
       while (1);
     }
-    BLE.setLocalName(_name.c_str());
+    _running = this;
+    _link.begin();
+    BLE.setLocalName(_name);
     BLE.setEventHandler(BLEConnected, bluetooth_connected);
     BLE.setEventHandler(BLEDisconnected, bluetooth_disconnected);
 
@@ -40,7 +71,7 @@ public:
     if (r == 1)
     {
       Serial.println("Bluetooth® device active.");
-      Serial.print(_name.c_str());
+      Serial.print(_name);
       Serial.print(": ");
       Serial.println(_serviceId.data());
     }
@@ -52,14 +83,32 @@ public:
   }
 
 private:
-  const std::string _name;
+  const char* const _name; // must outlive the runner, like a literal
   const BLEUUID _serviceId;
   BLEService _bleService;
   Task _bluetoothTask;
+  BLETelemetrySink* _sinks = nullptr;
+  BLEDisconnectListener* _listeners = nullptr;
+  BLELinkPolicy _link;
+
+  // BLE is a single local device, so there is one running service.
+  inline static BLEServiceRunner* _running = nullptr;
+
+  void notifyDisconnected()
+  {
+    for (BLEDisconnectListener* l = _listeners; l; l = l->nextListener)
+    {
+      l->disconnected();
+    }
+    _link.disconnected();
+  }
 
   static void loop()
   {
+    SBJ_LATENCY_POLL_BEGIN();
     BLE.poll();
+    SBJ_LATENCY_POLL_END();
+    if (_running) _running->_link.poll();
   }
 
   static void bluetooth_connected(BLEDevice device)
@@ -67,6 +116,11 @@ private:
     Serial.println();
     Serial.print("BT Connected: ");
     Serial.println(device.address());
+    if (_running)
+    {
+      _running->_link.connected();
+      _running->_link.info().printTo(Serial);
+    }
   }
 
   static void bluetooth_disconnected(BLEDevice device)
@@ -74,5 +128,11 @@ private:
     Serial.println();
     Serial.print("BT Disconnected: ");
     Serial.println(device.address());
+    if (_running)
+    {
+      _running->notifyDisconnected();
+    }
   }
 };
+
+#endif
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+
+#include "../PinIO/TaskThunk.h"
+#include "IDBTCharacteristic.h"
+#include "BLETelemetrySink.h"
+#include "BLEWriteLock.h"
+
+/*
+Opt-in aggregate of every notifying characteristic constructed after it.
+Dirty fields are packed into one notification per interval, up to the
+payload limit; anything left over goes out on the next interval. The
+per-field characteristics keep notifying as before. publish() may run on
+the NimBLE host task; the staging area is shared under a BLEWriteLock.
+
+The limit is ATT_MTU - 3 and never more. ArduinoBLE does not report the
+MTU and truncates notifications to that size, so there the limit stays at
+payloadBytes and a field that cannot fit it alone (over 12 bytes at the
+default 20) is refused when it attaches. NimBLE learns the MTU; a field
+too large for the negotiated one is skipped.
+
+Frame (little endian):
+  u8  version
+  u8  sequence
+  u8  field count
+  per field:
+    u32 property key (the 8 hex characters of the property id)
+    u8  length
+    u8  value[length]
+*/
+struct BLETelemetryTraitsDft
+{
+  static constexpr const char* bleProperty = "00010002";
+  static constexpr uint32_t intervalMs   = 50;   // about one connection interval
+  static constexpr size_t   maxFields    = 16;
+  static constexpr size_t   stagingBytes = 192;  // sum of attached value sizes
+  static constexpr size_t   payloadBytes = 20;   // ATT_MTU 23 until told otherwise
+};
+
+template <typename Traits = BLETelemetryTraitsDft>
+class BLETelemetry : public BLETelemetrySink, ScheduledRunner
+{
+public:
+  static constexpr uint8_t Version = 1;
+  static constexpr size_t MaxPayload = 244;
+  static constexpr size_t HeaderBytes = 3;
+  static constexpr size_t FieldHeaderBytes = 5;
+  static constexpr size_t MaxField = (SBJ_BLE_NIMBLE ? MaxPayload : Traits::payloadBytes) - HeaderBytes - FieldHeaderBytes;
+
+  BLETelemetry(Scheduler& scheduler, BLEServiceRunner& ble)
+  : _frame{}
+  , _runner(ble)
+  , _telemetryChar(ble, Traits::bleProperty, MaxPayload, _frame.data(), nullptr)
+  , _task(scheduler, Traits::intervalMs, this)
+  {
+    _frame[0] = Version;
+    _telemetryChar.writeRaw(_frame.data(), HeaderBytes);
+    ble.addTelemetrySink(*this);
+  }
+
+  // ATT_MTU - 3; follows the negotiated MTU when the backend reports it.
+  void setPayloadLimit(size_t bytes)
+  {
+    if (bytes < HeaderBytes + FieldHeaderBytes + 1) bytes = HeaderBytes + FieldHeaderBytes + 1;
+    _payloadLimit = bytes > MaxPayload ? MaxPayload : bytes;
+  }
+
+  size_t payloadLimit() const { return _payloadLimit; }
+
+  virtual void attach(uint32_t key, size_t size) override
+  {
+    if (find(key) >= 0) return;
+    if (size > MaxField)
+    {
+      Serial.println("Telemetry: field dropped, larger than a frame");
+      return;
+    }
+    if (_fieldCount >= Traits::maxFields || _stagingUsed + size > Traits::stagingBytes)
+    {
+      Serial.println("Telemetry: field dropped, raise maxFields/stagingBytes");
+      return;
+    }
+    Field& f = _fields[_fieldCount++];
+    f.key = key;
+    f.offset = static_cast<uint16_t>(_stagingUsed);
+    f.size = static_cast<uint8_t>(size);
+    f.length = 0;
+    f.dirty = false;
+    _stagingUsed += size;
+  }
+
+  virtual void publish(uint32_t key, const void* data, size_t length) override
+  {
+    const int idx = find(key);
+    if (idx < 0) return;
+    Field& f = _fields[idx];
+    if (length > f.size) length = f.size;
+    BLEWriteLock::Guard guard(_lock);
+    std::memcpy(_staging.data() + f.offset, data, length);
+    f.length = static_cast<uint8_t>(length);
+    f.dirty = true;
+  }
+
+private:
+  struct Field
+  {
+    uint32_t key;
+    uint16_t offset;
+    uint8_t  size;
+    uint8_t  length;
+    bool     dirty;
+  };
+
+  std::array<uint8_t, MaxPayload> _frame;
+  BLEServiceRunner& _runner;
+  IDBTCharacteristic _telemetryChar;
+  TaskThunk _task;
+
+  std::array<Field, Traits::maxFields> _fields{};
+  std::array<uint8_t, Traits::stagingBytes> _staging{};
+  size_t  _fieldCount = 0;
+  size_t  _stagingUsed = 0;
+  size_t  _cursor = 0;
+  size_t  _payloadLimit = Traits::payloadBytes;
+  uint8_t _sequence = 0;
+  uint16_t _seenMtu = 0;
+  BLEWriteLock _lock;
+
+  int find(uint32_t key) const
+  {
+    for (size_t i = 0; i < _fieldCount; ++i)
+    {
+      if (_fields[i].key == key) return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  virtual void loop(Task&) override
+  {
+    if (_fieldCount == 0 || !_telemetryChar.subscribed()) return;
+
+    const uint16_t mtu = _runner.link().info().mtu;
+    if (mtu != 0 && mtu != _seenMtu)
+    {
+      _seenMtu = mtu;
+      setPayloadLimit(mtu - 3);
+    }
+
+    uint8_t packed = 0;
+    const size_t used = pack(packed);
+    if (packed == 0) return;
+
+    _frame[0] = Version;
+    _frame[1] = _sequence++;
+    _frame[2] = packed;
+    _telemetryChar.writeRaw(_frame.data(), used);
+  }
+
+  // Copy dirty fields into the frame; returns the bytes used. The lock is
+  // not held across the notify.
+  size_t pack(uint8_t& packed)
+  {
+    size_t used = HeaderBytes;
+    BLEWriteLock::Guard guard(_lock);
+    // Start after the last field sent so a small MTU cannot starve the tail.
+    for (size_t n = 0; n < _fieldCount; ++n)
+    {
+      const size_t idx = (_cursor + n) % _fieldCount;
+      Field& f = _fields[idx];
+      if (!f.dirty) continue;
+      const size_t need = FieldHeaderBytes + f.length;
+      if (HeaderBytes + need > _payloadLimit)
+      {
+        f.dirty = false; // cannot fit any frame at this MTU
+        continue;
+      }
+      if (used + need > _payloadLimit) continue;
+      uint8_t* out = _frame.data() + used;
+      out[0] = static_cast<uint8_t>(f.key);
+      out[1] = static_cast<uint8_t>(f.key >> 8);
+      out[2] = static_cast<uint8_t>(f.key >> 16);
+      out[3] = static_cast<uint8_t>(f.key >> 24);
+      out[4] = f.length;
+      std::memcpy(out + FieldHeaderBytes, _staging.data() + f.offset, f.length);
+      used += need;
+      f.dirty = false;
+      _cursor = idx + 1;
+      ++packed;
+    }
+    return used;
+  }
+};
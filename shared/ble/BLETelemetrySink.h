@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Observer of notifying characteristic values, keyed by 4 byte property key.
+// Sinks chain off the service runner; every IDBTCharacteristic::writeValue
+// is offered to each sink after the characteristic itself is updated.
+class BLETelemetrySink
+{
+public:
+  virtual ~BLETelemetrySink() = default;
+
+  // A notifying characteristic of this size exists under key.
+  virtual void attach(uint32_t key, size_t size) = 0;
+
+  // The characteristic under key now holds data.
+  virtual void publish(uint32_t key, const void* data, size_t length) = 0;
+
+  BLETelemetrySink* nextSink = nullptr;
+};
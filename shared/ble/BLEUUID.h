@@ -1,39 +1,68 @@
 #pragma once
 
-#include <ArduinoBLE.h>
-#include <string>
 #include <array>
-#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 
 using BLEUUID = std::array<char, 37>;
 
-inline BLEUUID makeUuidWithService(
-    const std::string& serviceName,
-    const std::string& overrideId)
+// 8 hex characters naming a property within a service, plus terminator.
+using BLEPropertyId = std::array<char, 9>;
+
+namespace BLEUUIDDetail
 {
-  BLEUUID result;
-  if (!overrideId.empty())
+  inline constexpr char hex[] = "0123456789ABCDEF";
+
+  constexpr bool equals(const BLEUUID& uuid, const char* expected)
   {
-    std::copy_n(overrideId.begin(), 37, result.begin());
+    for (size_t i = 0; i < uuid.size(); ++i)
+    {
+      if (uuid[i] != expected[i]) return false;
+      if (expected[i] == 0) return true;
+    }
+    return true;
   }
-  else
+}
+
+// "00000000-" followed by the hex of up to the first 12 characters of the
+// service name, dash separated like a UUID, zero filled.
+// Heap free and constexpr; output is byte-identical to the original
+// sprintf based builder for ASCII names.
+constexpr BLEUUID makeUuidWithService(
+    const char* serviceName,
+    const char* overrideId = nullptr)
+{
+  BLEUUID result{};
+  if (overrideId && overrideId[0])
   {
-    result.fill('0');
-    result[8] = '-';
-    result[36] = 0;
-    int pos = 9;
-    for (size_t i = 0; i < 12 && i < serviceName.length(); i++) {
-      sprintf(result.data() + pos, "%02X", serviceName[i]);
-      pos+=2;
-      if (i == 1 || i == 3 || i == 5)
-      {
-         result[pos] = '-';
-         pos+=1;
-      }
+    for (size_t i = 0; i < 36 && overrideId[i]; ++i)
+    {
+      result[i] = overrideId[i];
     }
-    if (serviceName.length() < 12) {
-	  result[pos] = '0';
+    result[36] = 0;
+    return result;
+  }
+
+  for (size_t i = 0; i < 36; ++i)
+  {
+    result[i] = '0';
+  }
+  result[8] = '-';
+  result[36] = 0;
+  size_t pos = 9;
+  for (size_t i = 0; i < 12 && serviceName && serviceName[i]; i++)
+  {
+    const uint8_t c = static_cast<uint8_t>(serviceName[i]);
+    result[pos++] = BLEUUIDDetail::hex[c >> 4];
+    result[pos++] = BLEUUIDDetail::hex[c & 0x0F];
+    if (i == 1 || i == 3 || i == 5)
+    {
+      result[pos++] = '-';
     }
   }
   return result;
 }
+
+static_assert(BLEUUIDDetail::equals(makeUuidWithService("Train Station"),
+                                    "00000000-5472-6169-6E20-53746174696F"),
+              "Service UUID derivation changed; deployed apps depend on it");
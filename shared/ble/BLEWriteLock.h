@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BLEBackend.h"
+
+#if SBJ_BLE_NIMBLE
+  #include "freertos/FreeRTOS.h"
+#endif
+
+/*
+Guards state that BLE write handlers share with scheduler tasks. NimBLE
+delivers writes on its host task, so there this is a FreeRTOS spinlock,
+held only for a short copy. ArduinoBLE delivers them from BLE.poll() on
+the scheduler task and the lock compiles away.
+*/
+class BLEWriteLock
+{
+public:
+#if SBJ_BLE_NIMBLE
+  void lock() { portENTER_CRITICAL(&_mux); }
+  void unlock() { portEXIT_CRITICAL(&_mux); }
+#else
+  void lock() {}
+  void unlock() {}
+#endif
+
+  class Guard
+  {
+  public:
+    explicit Guard(BLEWriteLock& lock) : _lock(lock) { _lock.lock(); }
+    ~Guard() { _lock.unlock(); }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+  private:
+    BLEWriteLock& _lock;
+  };
+
+private:
+#if SBJ_BLE_NIMBLE
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <Arduino.h>
+#include "BLEBackend.h"
+#include "BLELatencyProbe.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#ifndef SBJ_BLE_WRITE_ROUTES
+  #define SBJ_BLE_WRITE_ROUTES 16
+#endif
+
+// 4 byte property key from the 8 hex characters of a property id.
+constexpr uint32_t blePropertyKey(const char* propertyId)
+{
+  uint32_t key = 0;
+  for (size_t i = 0; i < 8 && propertyId && propertyId[i]; ++i)
+  {
+    const char c = propertyId[i];
+    const uint32_t nibble =
+      (c >= '0' && c <= '9') ? uint32_t(c - '0') :
+      (c >= 'A' && c <= 'F') ? uint32_t(c - 'A' + 10) :
+      (c >= 'a' && c <= 'f') ? uint32_t(c - 'a' + 10) : 0u;
+    key = (key << 4) | nibble;
+  }
+  return key;
+}
+
+/*
+Routes characteristic writes to bound member functions.
+
+ArduinoBLE handlers are plain function pointers with no user context, so each
+route slot gets its own compile-time generated handler. Binding hands out the
+next slot's handler; a write then indexes straight into the route table.
+No per-class singleton pointers, any number of instances.
+
+NimBLE callbacks carry their own object, so there a characteristic just
+adds a route and invokes its slot directly.
+*/
+class BLEWriteRouter
+{
+public:
+  static constexpr size_t Capacity = SBJ_BLE_WRITE_ROUTES;
+
+  using Call = void (*)(void* obj, const uint8_t* data, size_t length);
+  using Activity = void (*)(void* ctx);
+
+  // Member adapter for a descriptor's Method. Methods either take the raw
+  // bytes or a const reference to Desc::Value (copied like readValue does).
+  template <typename Desc>
+  static void call(void* obj, const uint8_t* data, size_t length)
+  {
+    using Obj = typename Desc::Obj;
+    using Value = typename Desc::Value;
+    Obj* self = static_cast<Obj*>(obj);
+    if constexpr (std::is_invocable_v<decltype(Desc::Method), Obj*, const uint8_t*, size_t>)
+    {
+      (self->*Desc::Method)(data, length);
+    }
+    else
+    {
+      Value value{};
+      std::memcpy(&value, data, length < sizeof(Value) ? length : sizeof(Value));
+      (self->*Desc::Method)(value);
+    }
+  }
+
+  // Returns the slot of a newly added route, or -1 when full or unbound.
+  static int add(uint32_t key, void* obj, Call fn)
+  {
+    State& s = state();
+    if (!obj || !fn)
+    {
+      Serial.println("BLE: write route without a handler");
+      return -1;
+    }
+    if (s.count >= Capacity)
+    {
+      Serial.println("BLE: write route table full");
+      return -1;
+    }
+    const size_t slot = s.count++;
+    s.routes[slot] = Route{ key, obj, fn };
+    return static_cast<int>(slot);
+  }
+
+  // Called from the backend's write callback, which marks the event.
+  static void invoke(int slot, const uint8_t* data, size_t length)
+  {
+    State& s = state();
+    const Route& r = s.routes[slot];
+    written(s);
+    r.fn(r.obj, data, length);
+    SBJ_LATENCY_HANDLED();
+  }
+
+  // Routed and dispatched writes so far.
+  static uint32_t writes()
+  {
+    return state().writes.load(std::memory_order_relaxed);
+  }
+
+  // Called before the handler of every write, on the task delivering it.
+  // BLELinkPolicy hooks in here to follow command activity.
+  static void setActivity(Activity fn, void* ctx)
+  {
+    State& s = state();
+    s.activity = fn;
+    s.activityCtx = ctx;
+  }
+
+#if !SBJ_BLE_NIMBLE
+  // Returns the handler for a newly bound route, or nullptr when full.
+  static BLECharacteristicEventHandler bind(uint32_t key, void* obj, Call fn)
+  {
+    const int slot = add(key, obj, fn);
+    return slot < 0 ? nullptr : handlers()[slot];
+  }
+#endif
+
+  // Deliver a write by property key, for transports that carry several
+  // properties in one characteristic. Counts as a write like invoke().
+  static bool dispatch(uint32_t key, const uint8_t* data, size_t length)
+  {
+    State& s = state();
+    for (size_t i = 0; i < s.count; ++i)
+    {
+      if (s.routes[i].key == key)
+      {
+        written(s);
+        s.routes[i].fn(s.routes[i].obj, data, length);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool contains(uint32_t key)
+  {
+    const State& s = state();
+    for (size_t i = 0; i < s.count; ++i)
+    {
+      if (s.routes[i].key == key) return true;
+    }
+    return false;
+  }
+
+private:
+  struct Route
+  {
+    uint32_t key;
+    void*    obj;
+    Call     fn;
+  };
+
+  struct State
+  {
+    std::array<Route, Capacity> routes{};
+    size_t count = 0;
+    std::atomic<uint32_t> writes{0};
+    Activity activity = nullptr;
+    void* activityCtx = nullptr;
+  };
+
+  static State& state()
+  {
+    static State s;
+    return s;
+  }
+
+  static void written(State& s)
+  {
+    s.writes.fetch_add(1, std::memory_order_relaxed);
+    if (s.activity) s.activity(s.activityCtx);
+  }
+
+#if !SBJ_BLE_NIMBLE
+  template <size_t Slot>
+  static void handler(BLEDevice, BLECharacteristic characteristic)
+  {
+    SBJ_LATENCY_EVENT();
+    invoke(Slot, characteristic.value(), static_cast<size_t>(characteristic.valueLength()));
+  }
+
+  template <size_t... Slots>
+  static constexpr std::array<BLECharacteristicEventHandler, Capacity>
+  makeHandlers(std::index_sequence<Slots...>)
+  {
+    return {{ &handler<Slots>... }};
+  }
+
+  static const std::array<BLECharacteristicEventHandler, Capacity>& handlers()
+  {
+    static constexpr std::array<BLECharacteristicEventHandler, Capacity> table =
+      makeHandlers(std::make_index_sequence<Capacity>{});
+    return table;
+  }
+#endif
+};
@@ -2,45 +2,122 @@
 
 #include "BLEUUID.h"
 #include "BLEServiceRunner.h"
-#include <string>
+#include "BLEWriteRouter.h"
 
-static inline std::string writeIndex(const char * src, uint8_t value)
+#include <cstring>
+#include <type_traits>
+
+// Property id with the instance index written into characters 4-5.
+constexpr BLEPropertyId writeIndex(const char * src, uint8_t value)
 {
-  static const char hex[16] = {
-    '0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'
-  };
-  std::string buf = src;
-  if (buf.size() < 8) buf.resize(8, '0');
-  buf[4] = hex[(value >> 4) & 0x0F];
-  buf[5] = hex[value & 0x0F];
+  BLEPropertyId buf{};
+  bool ended = (src == nullptr);
+  for (size_t i = 0; i < 8; ++i)
+  {
+    if (!ended && src[i] == 0) ended = true;
+    buf[i] = ended ? '0' : src[i];
+  }
+  buf[4] = BLEUUIDDetail::hex[(value >> 4) & 0x0F];
+  buf[5] = BLEUUIDDetail::hex[value & 0x0F];
+  buf[8] = '\0';
   return buf;
 }
 
-
-static inline BLEUUID makeUuidWithProperty(
-    const std::string& propertyId,
+constexpr BLEUUID makeUuidWithProperty(
+    const char* propertyId,
     const BLEUUID& serviceId)
 {
   BLEUUID out {};
-  std::copy_n(serviceId.begin(), 36, out.begin());
-  std::copy_n(propertyId.begin(), 8, out.begin());
+  for (size_t i = 0; i < 36; ++i)
+  {
+    out[i] = serviceId[i];
+  }
+  for (size_t i = 0; i < 8 && propertyId && propertyId[i]; ++i)
+  {
+    out[i] = propertyId[i];
+  }
   out[36] = '\0';
   return out;
 }
 
-struct IDBTCharacteristic {
+/*
+Characteristic schema descriptor, declared next to the owning class:
+
+  struct PowerControlDesc {
+    using Obj = Lighting;
+    using Value = uint8_t;
+    static constexpr const char* property = "03020001";
+    static constexpr bool notify = false;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::updatePower;
+  };
+
+UUID, permissions and size come from the descriptor; writes are routed to
+Method on the bound object through BLEWriteRouter. Method may instead take
+(const uint8_t* data, size_t length) for variable length payloads.
+*/
+template <typename Desc>
+constexpr unsigned char blePermissions()
+{
+  unsigned char p = BLEWriteWithoutResponse;
+  if (Desc::notify)
+  {
+    p |= BLERead;
+    p |= BLENotify;
+  }
+  return p;
+}
+
+// Descriptors may opt out of telemetry sinks with
+//   static constexpr bool telemetry = false;
+template <typename Desc, typename = void>
+struct bleDescTelemetry : std::true_type {};
+
+template <typename Desc>
+struct bleDescTelemetry<Desc, std::void_t<decltype(Desc::telemetry)>>
+  : std::bool_constant<Desc::telemetry> {};
+
+/*
+On NimBLE the characteristic registers with the runner and is created when
+the runner begins; until then ble is null and writes are dropped. The
+initial value pointer is read at that point, so it must stay valid.
+*/
+struct IDBTCharacteristic
+#if SBJ_BLE_NIMBLE
+  : TheBLEAttribute, NimBLECharacteristicCallbacks
+#endif
+{
   const BLEUUID uuid; // Must remain in memory with characteristic
+#if SBJ_BLE_NIMBLE
+  NimBLECharacteristic* ble = nullptr;
+#else
   BLECharacteristic ble;
+#endif
 
   IDBTCharacteristic(
     BLEServiceRunner& runner,
-    const std::string& propertyId, // hex of 4 byte id
+    const char* propertyId, // hex of 4 byte id
     size_t valueSize, // store value of this size, ~180–244 bytes per characteristic write/notify
     const void* value, // initial value of valueSize
     BLECharacteristicEventHandler eventHandler)
   : uuid(makeUuidWithProperty(propertyId, runner.serviceId()))
+#if SBJ_BLE_NIMBLE
+  , _properties(adjustPermissions(0, value, eventHandler))
+  , _size(valueSize)
+  , _initial(value)
+  , _eventHandler(eventHandler)
+#else
   , ble(uuid.data(), adjustPermissions(0, value, eventHandler), valueSize)
+#endif
+  , _runner(runner)
+  , _key(blePropertyKey(propertyId))
   {
+#if SBJ_BLE_NIMBLE
+    if (value)
+    {
+      attachSinks(valueSize);
+    }
+    runner.addAttribute(*this);
+#else
     if (eventHandler)
     {
       ble.setEventHandler(BLEWritten, eventHandler);
@@ -48,14 +125,16 @@ struct IDBTCharacteristic {
     if (value)
     {
       ble.writeValue(static_cast<const unsigned char*>(value), valueSize);
+      attachSinks(valueSize);
     }
     runner.addCharacteristic(ble);
+#endif
   }
 
   template <typename T>
   IDBTCharacteristic(
     BLEServiceRunner& runner,
-    const std::string& propertyId,
+    const char* propertyId,
     const T* value,
     BLECharacteristicEventHandler eventHandler = NULL)
     : IDBTCharacteristic(runner, propertyId, sizeof(T), value, eventHandler) {}
@@ -63,15 +142,176 @@ struct IDBTCharacteristic {
   template <typename T, std::size_t N>
   IDBTCharacteristic(
     BLEServiceRunner& runner,
-    const std::string& propertyId,
+    const char* propertyId,
     const std::array<T, N>& value,
     BLECharacteristicEventHandler eventHandler = NULL)
     : IDBTCharacteristic(runner, propertyId, sizeof(value), value.data(), eventHandler) {}
 
-	//TODO: use the UUID on eventHandler to route to a lambda extression
-	//Create a new static class for this so we don't multiple these constructors
+  // The initial value must outlive the constructor (see above).
+  template <typename T, std::size_t N>
+  IDBTCharacteristic(
+    BLEServiceRunner& runner,
+    const char* propertyId,
+    const std::array<T, N>&& value,
+    BLECharacteristicEventHandler eventHandler = NULL) = delete;
+
+  // Schema constructor. A null obj leaves the characteristic read-only.
+  template <typename Desc>
+  IDBTCharacteristic(
+    BLEServiceRunner& runner,
+    typename Desc::Obj* obj,
+    const typename Desc::Value* value,
+    Desc = Desc{})
+  : uuid(makeUuidWithProperty(Desc::property, runner.serviceId()))
+#if SBJ_BLE_NIMBLE
+  , _properties(obj ? blePermissions<Desc>() : (blePermissions<Desc>() & ~BLEWriteWithoutResponse))
+  , _size(sizeof(typename Desc::Value))
+  , _initial(Desc::notify ? value : nullptr)
+#else
+  , ble(uuid.data(),
+        obj ? blePermissions<Desc>() : (blePermissions<Desc>() & ~BLEWriteWithoutResponse),
+        sizeof(typename Desc::Value))
+#endif
+  , _runner(runner)
+  , _key(blePropertyKey(Desc::property))
+  {
+    static_assert(std::is_trivially_copyable_v<typename Desc::Value>,
+                  "Characteristic values are raw bytes on the wire");
+#if SBJ_BLE_NIMBLE
+    if (obj)
+    {
+      _route = BLEWriteRouter::add(
+        blePropertyKey(Desc::property), obj, &BLEWriteRouter::template call<Desc>);
+    }
+#else
+    if (obj)
+    {
+      BLECharacteristicEventHandler handler = BLEWriteRouter::bind(
+        blePropertyKey(Desc::property), obj, &BLEWriteRouter::template call<Desc>);
+      if (handler) ble.setEventHandler(BLEWritten, handler);
+    }
+    if (Desc::notify && value)
+    {
+      ble.writeValue(reinterpret_cast<const unsigned char*>(value), sizeof(*value));
+    }
+#endif
+    if (Desc::notify && bleDescTelemetry<Desc>::value)
+    {
+      attachSinks(sizeof(typename Desc::Value));
+    }
+#if SBJ_BLE_NIMBLE
+    runner.addAttribute(*this);
+#else
+    runner.addCharacteristic(ble);
+#endif
+  }
+
+  // Update (and notify) the value, then offer it to the telemetry sinks.
+  bool writeValue(const void* data, size_t length)
+  {
+    const bool ok = writeRaw(data, length);
+    for (BLETelemetrySink* sink = _runner.telemetrySinks(); sink; sink = sink->nextSink)
+    {
+      sink->publish(_key, data, length);
+    }
+    return ok;
+  }
+
+  template <typename T>
+  bool writeValue(const T& value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "Characteristic values are raw bytes on the wire");
+    return writeValue(&value, sizeof(T));
+  }
+
+  // Update (and notify) the value only; for aggregates and protocol replies.
+  bool writeRaw(const void* data, size_t length)
+  {
+#if SBJ_BLE_NIMBLE
+    if (!ble) return false;
+    ble->setValue(static_cast<const uint8_t*>(data), length);
+    if (_properties & BLENotify) ble->notify();
+    return true;
+#else
+    return ble.writeValue(static_cast<const unsigned char*>(data), length);
+#endif
+  }
+
+  bool subscribed()
+  {
+#if SBJ_BLE_NIMBLE
+    return _subscribed;
+#else
+    return ble.subscribed();
+#endif
+  }
+
+  uint32_t key() const { return _key; }
+
+protected:
+  // Point the initial value at storage that outlives the constructor argument.
+  void rebindInitial(const void* value)
+  {
+#if SBJ_BLE_NIMBLE
+    _initial = value;
+#endif
+  }
 
 private:
+#if SBJ_BLE_NIMBLE
+  const unsigned char _properties;
+  const size_t _size;
+  const void* _initial;
+  BLECharacteristicEventHandler _eventHandler = nullptr;
+  int _route = -1;
+  bool _subscribed = false;
+
+  virtual void create(NimBLEService& service) override
+  {
+    uint32_t p = 0;
+    if (_properties & BLERead) p |= NIMBLE_PROPERTY::READ;
+    if (_properties & BLEWriteWithoutResponse) p |= NIMBLE_PROPERTY::WRITE_NR;
+    if (_properties & BLENotify) p |= NIMBLE_PROPERTY::NOTIFY;
+    ble = service.createCharacteristic(uuid.data(), p, _size);
+    ble->setCallbacks(this);
+    if (_initial)
+    {
+      ble->setValue(static_cast<const uint8_t*>(_initial), _size);
+    }
+  }
+
+  virtual void onWrite(NimBLECharacteristic* characteristic, NimBLEConnInfo&) override
+  {
+    if (_route >= 0)
+    {
+      SBJ_LATENCY_EVENT();
+      const NimBLEAttValue value = characteristic->getValue();
+      BLEWriteRouter::invoke(_route, value.data(), value.size());
+    }
+    else if (_eventHandler)
+    {
+      _eventHandler(characteristic);
+    }
+  }
+
+  // The app is the only central; one subscription flag is enough.
+  virtual void onSubscribe(NimBLECharacteristic*, NimBLEConnInfo&, uint16_t subValue) override
+  {
+    _subscribed = subValue != 0;
+  }
+#endif
+
+  BLEServiceRunner& _runner;
+  const uint32_t _key;
+
+  void attachSinks(size_t size)
+  {
+    for (BLETelemetrySink* sink = _runner.telemetrySinks(); sink; sink = sink->nextSink)
+    {
+      sink->attach(_key, size);
+    }
+  }
+
   static unsigned char adjustPermissions(
       unsigned char base,
       const void* value,
@@ -91,3 +331,108 @@ private:
   }
 };
 
+
+// Notify policy for IDBTValue.
+struct IDBTNotifyPolicyDft
+{
+  static constexpr long     deadband      = 0; // change vs last sent must exceed this
+  static constexpr uint32_t minIntervalMs = 0; // never notify more often than this
+  static constexpr uint32_t maxStaleMs    = 0; // resend an unchanged value this often (0 = never)
+};
+
+/*
+Managed value mode: the characteristic remembers what it last sent and
+decides when a new value is worth a notification. Changes inside the
+deadband are ignored (hysteresis around the last sent value), changes
+arriving faster than minIntervalMs are held and sent by poll() once the
+interval passes, and maxStaleMs re-sends a quiet value so late subscribers
+and telemetry sinks catch up.
+
+Owners call set() with every reading, or poll() from their loop when
+there is no new reading; set() polls too, so a steady value still gets
+its held-back send and stale refresh.
+*/
+template <typename T, typename Policy = IDBTNotifyPolicyDft>
+class IDBTValue : public IDBTCharacteristic
+{
+public:
+  static_assert(std::is_trivially_copyable_v<T>, "Characteristic values are raw bytes on the wire");
+
+  IDBTValue(BLEServiceRunner& runner, const char* propertyId, const T& initial)
+  : IDBTCharacteristic(runner, propertyId, sizeof(T), &initial, nullptr)
+  , _value(initial)
+  , _sent(initial)
+  {
+    rebindInitial(&_value);
+  }
+
+  template <typename Desc>
+  IDBTValue(BLEServiceRunner& runner, typename Desc::Obj* obj, const T& initial, Desc desc = Desc{})
+  : IDBTCharacteristic(runner, obj, &initial, desc)
+  , _value(initial)
+  , _sent(initial)
+  {
+    static_assert(std::is_same_v<typename Desc::Value, T>, "Descriptor value type mismatch");
+    rebindInitial(&_value);
+  }
+
+  const T& value() const { return _value; }
+  const T& sent() const { return _sent; }
+
+  // Record a new reading. Returns true if it was notified now.
+  bool set(const T& value, uint32_t now = millis())
+  {
+    _value = value;
+    _pending = exceedsDeadband(_value, _sent);
+    return poll(now);
+  }
+
+  // Send anything held back by the interval, or a stale refresh.
+  bool poll(uint32_t now = millis())
+  {
+    const uint32_t since = now - _sentMs;
+    if (_pending && (!_everSent || since >= Policy::minIntervalMs))
+    {
+      return send(now);
+    }
+    if (Policy::maxStaleMs != 0 && since >= Policy::maxStaleMs)
+    {
+      return send(now);
+    }
+    return false;
+  }
+
+private:
+  T        _value;
+  T        _sent;
+  uint32_t _sentMs = 0;
+  bool     _pending = false;
+  bool     _everSent = false;
+
+  bool send(uint32_t now)
+  {
+    writeValue(_value);
+    _sent = _value;
+    _sentMs = now;
+    _pending = false;
+    _everSent = true;
+    return true;
+  }
+
+  static bool exceedsDeadband(const T& a, const T& b)
+  {
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      const auto diff = (a > b) ? (a - b) : (b - a);
+      return diff > static_cast<decltype(diff)>(Policy::deadband);
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+      return a != b;
+    }
+    else
+    {
+      return std::memcmp(&a, &b, sizeof(T)) != 0;
+    }
+  }
+};
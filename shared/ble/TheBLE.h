@@ -1,66 +1,104 @@
 #pragma once
 
-#include <string>
-#include <vector>
-#include <array>
-#include <cstdint>
-#include <cstring>
+#include "BLEBackend.h"
 
-#include "../PinIO/SBJTask.h"
-#include "BLEUUID.h"
+#if !SBJ_BLE_NIMBLE
+
+#include "BLEServiceRunner.h"
+using TheBLE = BLEServiceRunner;
 
-// Select BLE backend
-#if __has_include(<ArduinoBLE.h>)
-  #define SBJ_BLE_USE_ARDUINOBLE 1
-  #include <ArduinoBLE.h>
-#elif __has_include(<NimBLEDevice.h>)
-  #define SBJ_BLE_USE_ARDUINOBLE 0
-  #include <NimBLEDevice.h>
 #else
-  #error "No supported BLE backend found. Install ArduinoBLE (UNO R4 etc.) or NimBLE-Arduino (ESP32)."
-#endif
 
-class TheBLE
+#include <Arduino.h>
+#include "BLEUUID.h"
+#include "BLETelemetrySink.h"
+#include "BLEDisconnectListener.h"
+#include "BLELinkPolicy.h"
+#include "../PinIO/TaskThunk.h"
+
+// Something to create in the GATT service once the stack is up. Attributes
+// register from constructors, which run before NimBLE may be initialised.
+class TheBLEAttribute
 {
 public:
-  inline TheBLE(
-    Scheduler& sched,
-    const std::string& name)
-  : _serviceName(name)
-  , _serviceId(makeUuidWithService(serviceName))
-#if SBJ_BLE_USE_ARDUINOBLE
-#else
-  , _task("BLE", &poll, Schedule{100})
-#endif
+  virtual void create(NimBLEService& service) = 0;
+  TheBLEAttribute* nextAttribute = nullptr;
+
+protected:
+  ~TheBLEAttribute() = default;
+};
+
+/*
+NimBLE service runner with the BLEServiceRunner interface. There is no
+polling task: writes are delivered by NimBLE callbacks on its host task as
+soon as the link layer hands them over, and notifies go out from the
+caller. Handlers that touch scheduler owned state must tolerate that. The
+link policy follows command activity from the write path and an esp_timer.
+*/
+class TheBLE : private NimBLEServerCallbacks
+{
+public:
+  TheBLE(Scheduler& /*scheduler*/, const char* serviceName, int /*pollMS*/ = 0, const char* overrideId = nullptr)
+  : _name(serviceName)
+  , _serviceId(makeUuidWithService(serviceName, overrideId))
+  {
+  }
+
+  const BLEUUID& serviceId() const { return _serviceId; }
+
+  // Attributes must be added before begin().
+  void addAttribute(TheBLEAttribute& attribute)
   {
+    attribute.nextAttribute = _attributes;
+    _attributes = &attribute;
   }
 
-  void addCharacteristic(BLECharacteristic& ble)
+  // Sinks only see characteristics constructed after they are added.
+  void addTelemetrySink(BLETelemetrySink& sink)
   {
-    _bleService.addCharacteristic(ble);
+    sink.nextSink = _sinks;
+    _sinks = &sink;
   }
 
+  BLETelemetrySink* telemetrySinks() const { return _sinks; }
+
+  void addDisconnectListener(BLEDisconnectListener& listener)
+  {
+    listener.nextListener = _listeners;
+    _listeners = &listener;
+  }
+
+  NimBLEServer* server() const { return _server; }
+
+  BLELinkPolicy& link() { return _link; }
+  const BLELinkPolicy& link() const { return _link; }
+
   void begin()
   {
-#if SBJ_BLE_USE_ARDUINOBLE
-#else
-    if (!BLE.begin())
+    if (!NimBLEDevice::init(_name))
     {
       Serial.println("Starting Bluetooth® Low Energy module failed!");
       while (1);
     }
-    BLE.setLocalName(_name.c_str());
-    BLE.setEventHandler(BLEConnected, bluetooth_connected);
-    BLE.setEventHandler(BLEDisconnected, bluetooth_disconnected);
+    _link.begin();
+    _server = NimBLEDevice::createServer();
+    _server->setCallbacks(this, false);
 
-    BLE.setAdvertisedService(_bleService);
-    BLE.addService(_bleService);
+    NimBLEService* service = _server->createService(_serviceId.data());
+    for (TheBLEAttribute* a = _attributes; a; a = a->nextAttribute)
+    {
+      a->create(*service);
+    }
+    service->start();
 
-    int r = BLE.advertise();
-    if (r == 1)
+    NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
+    advertising->setName(_name);
+    advertising->addServiceUUID(_serviceId.data());
+    advertising->enableScanResponse(true);
+    if (advertising->start())
     {
       Serial.println("Bluetooth® device active.");
-      Serial.print(_name.c_str());
+      Serial.print(_name);
       Serial.print(": ");
       Serial.println(_serviceId.data());
     }
@@ -69,34 +107,55 @@ public:
       Serial.println("Bluetooth® activation failed!");
       while (1);
     }
-#endif
   }
 
 private:
-  std::string _serviceName;
-  BLEUUID _serviceId;
-  SBJTask _task;
-  
-#if SBJ_BLE_USE_ARDUINOBLE
-#else
-  BLEService _bleService;
-  static void poll()
-  {
-    BLE.poll();
-  }
+  const char* const _name; // must outlive the runner, like a literal
+  const BLEUUID _serviceId;
+  NimBLEServer* _server = nullptr;
+  TheBLEAttribute* _attributes = nullptr;
+  BLETelemetrySink* _sinks = nullptr;
+  BLEDisconnectListener* _listeners = nullptr;
+  BLELinkPolicy _link;
 
-  static void bluetooth_connected(BLEDevice device)
+  virtual void onConnect(NimBLEServer*, NimBLEConnInfo& connInfo) override
   {
     Serial.println();
     Serial.print("BT Connected: ");
-    Serial.println(device.address());
+    Serial.println(connInfo.getAddress().toString().c_str());
+    _link.connected(connInfo);
+  }
+
+  virtual void onConnParamsUpdate(NimBLEConnInfo& connInfo) override
+  {
+    _link.paramsUpdated(connInfo);
+    _link.info().printTo(Serial);
+  }
+
+  virtual void onMTUChange(uint16_t mtu, NimBLEConnInfo&) override
+  {
+    _link.mtuChanged(mtu);
+  }
+
+  virtual void onPhyUpdate(NimBLEConnInfo&, uint8_t txPhy, uint8_t rxPhy) override
+  {
+    _link.phyUpdated(txPhy, rxPhy);
   }
 
-  static void bluetooth_disconnected(BLEDevice device)
+  virtual void onDisconnect(NimBLEServer*, NimBLEConnInfo& connInfo, int) override
   {
     Serial.println();
     Serial.print("BT Disconnected: ");
-    Serial.println(device.address());
+    Serial.println(connInfo.getAddress().toString().c_str());
+    for (BLEDisconnectListener* l = _listeners; l; l = l->nextListener)
+    {
+      l->disconnected();
+    }
+    _link.disconnected();
+    NimBLEDevice::startAdvertising();
   }
-#endif
 };
+
+using BLEServiceRunner = TheBLE;
+
+#endif
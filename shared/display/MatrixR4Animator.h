@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+#include "MatrixR4Value.h"
+#include "MatrixR4Bits.h"
+
+/*
+Transition between two matrix values, one frame per next() call.
+
+Pixels only in the source shrink away towards the centre of their
+bounding box, pixels only in the destination move in from the nearest lit
+source pixel one step per frame, and pixels in both stay. From a blank
+matrix the destination is revealed by a box growing from its centre.
+At most 10 steps, then the destination itself.
+
+start() does the nearest-neighbour matching once; the per-frame state is
+the mover positions (int8 points) plus a few masks, so nothing large goes
+on the stack and nothing runs inside the BLE write callback.
+*/
+class MatrixR4Animator
+{
+public:
+  using Value = MatrixR4Value::Value;
+
+  static constexpr int MaxSteps = 10;
+
+  bool active() const { return _mode != Mode::Idle; }
+
+  void start(const Value& src, const Value& dst)
+  {
+    _dst = dst;
+    _step = 0;
+    _moverN = 0;
+
+    if (src == dst)
+    {
+      _steps = 0;
+      _mode = Mode::Final;
+      return;
+    }
+
+    if (MatrixR4Bits::empty(src))
+    {
+      _box = MatrixR4Bits::bbox(dst);
+      const int cx = (_box.l + _box.r) / 2;
+      const int cy = (_box.t + _box.b) / 2;
+      _start = Rect{ cx, cy, cx, cy };
+      _steps = std::min(MaxSteps, std::max(1, std::max(_box.r - _box.l, _box.b - _box.t)));
+      _mode = Mode::Reveal;
+      return;
+    }
+
+    for (int i = 0; i < MatrixR4Value::WordCount; ++i)
+    {
+      _overlap[i] = src[i] & dst[i];
+      _srcOnly[i] = src[i] & ~dst[i];
+      _dstOnly[i] = dst[i] & ~src[i];
+    }
+    _box = MatrixR4Bits::bbox(_srcOnly);
+
+    // Every destination-only pixel starts at its nearest lit source pixel
+    // (first in scan order on ties).
+    int maxMove = 0;
+    MatrixR4Bits::forEach(_dstOnly, [&](int d)
+    {
+      const Pt to = pt(d);
+      Pt best = to;
+      int bd = std::numeric_limits<int>::max();
+      MatrixR4Bits::forEach(src, [&](int s)
+      {
+        const int dist = chebyshev(pt(s), to);
+        if (dist < bd)
+        {
+          bd = dist;
+          best = pt(s);
+        }
+        return bd > 0;
+      });
+      _movers[_moverN++] = best;
+      maxMove = std::max(maxMove, bd);
+      return true;
+    });
+
+    const int disappear = rectEmpty(_box) ? 0 : std::max(_box.r - _box.l, _box.b - _box.t) + 1;
+    _steps = std::min(MaxSteps, std::max({ 1, maxMove, disappear }));
+    _mode = Mode::Move;
+  }
+
+  // Writes the next frame; false once the destination has been produced.
+  bool next(Value& frame)
+  {
+    if (_mode == Mode::Idle) return false;
+    if (_step >= _steps)
+    {
+      frame = _dst;
+      _mode = Mode::Idle;
+      return true;
+    }
+    ++_step;
+    frame = _mode == Mode::Reveal ? revealFrame() : moveFrame();
+    return true;
+  }
+
+private:
+  enum class Mode : uint8_t { Idle, Final, Reveal, Move };
+
+  struct Pt { int8_t x; int8_t y; };
+  using Rect = MatrixR4Bits::Box;
+
+  Value _dst{};
+  Value _overlap{};
+  Value _srcOnly{};
+  Value _dstOnly{};
+  Rect  _box{};
+  Rect  _start{};
+  std::array<Pt, MatrixR4Value::TotalBits> _movers{};
+  int   _moverN = 0;
+  int   _steps = 0;
+  int   _step = 0;
+  Mode  _mode = Mode::Idle;
+
+  static bool rectEmpty(const Rect& rc) { return rc.r < rc.l || rc.b < rc.t; }
+  static int sign(int v) { return (v > 0) - (v < 0); }
+
+  static Pt pt(int index)
+  {
+    return Pt{ static_cast<int8_t>(index % MatrixR4Value::Width), static_cast<int8_t>(index / MatrixR4Value::Width) };
+  }
+
+  static int chebyshev(Pt a, Pt b)
+  {
+    const int dx = a.x > b.x ? a.x - b.x : b.x - a.x;
+    const int dy = a.y > b.y ? a.y - b.y : b.y - a.y;
+    return dx > dy ? dx : dy;
+  }
+
+  static int lerpInt(int a, int b, int num, int den)
+  {
+    return static_cast<int>((static_cast<int64_t>(a) * (den - num) + static_cast<int64_t>(b) * num + den / 2) / den);
+  }
+
+  Value revealFrame() const
+  {
+    if (rectEmpty(_box)) return MatrixR4Value::allOff;
+    Rect rc{
+      lerpInt(_start.l, _box.l, _step, _steps),
+      lerpInt(_start.t, _box.t, _step, _steps),
+      lerpInt(_start.r, _box.r, _step, _steps),
+      lerpInt(_start.b, _box.b, _step, _steps)
+    };
+    rc.l = std::max(0, std::min(MatrixR4Value::Width - 1, rc.l));
+    rc.r = std::max(0, std::min(MatrixR4Value::Width - 1, rc.r));
+    rc.t = std::max(0, std::min(MatrixR4Value::Height - 1, rc.t));
+    rc.b = std::max(0, std::min(MatrixR4Value::Height - 1, rc.b));
+    return MatrixR4Bits::clip(_dst, rc);
+  }
+
+  Value moveFrame()
+  {
+    Value f = _overlap;
+    if (!rectEmpty(_box))
+    {
+      const int mx = (_box.l + _box.r) / 2;
+      const int my = (_box.t + _box.b) / 2;
+      const Rect rc{
+        lerpInt(_box.l, mx + 1, _step, _steps),
+        lerpInt(_box.t, my + 1, _step, _steps),
+        lerpInt(_box.r, mx, _step, _steps),
+        lerpInt(_box.b, my, _step, _steps)
+      };
+      if (!rectEmpty(rc))
+      {
+        const Value shrinking = MatrixR4Bits::clip(_srcOnly, rc);
+        for (int i = 0; i < MatrixR4Value::WordCount; ++i) f[i] |= shrinking[i];
+      }
+    }
+
+    // Movers are matched to destination-only pixels in scan order.
+    int m = 0;
+    MatrixR4Bits::forEach(_dstOnly, [&](int d)
+    {
+      const Pt to = pt(d);
+      Pt& cur = _movers[m++];
+      cur.x = static_cast<int8_t>(cur.x + sign(to.x - cur.x));
+      cur.y = static_cast<int8_t>(cur.y + sign(to.y - cur.y));
+      MatrixR4Value::setBit(f, MatrixR4Value::getIndex(cur.y, cur.x), true);
+      return m < _moverN;
+    });
+    return f;
+  }
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/*
+Word-level operations on the 12x8 matrix bitboard: three uint32 words,
+pixel index y * 12 + x, MSB first. A row is 12 bits with x = 0 in bit 11,
+so the row value reads left to right like the matrix.
+*/
+namespace MatrixR4Bits
+{
+  using Value = std::array<uint32_t, 3>;
+
+  constexpr int Width  = 12;
+  constexpr int Height = 8;
+  constexpr uint16_t RowMask = 0x0FFF;
+
+  struct Box { int l; int t; int r; int b; };  // empty: r < l
+
+  constexpr uint16_t row(const Value& v, int y)
+  {
+    const int start = y * Width;
+    const int word = start / 32;
+    const int off = start % 32;
+    const uint64_t pair = (uint64_t(v[word]) << 32) | (word + 1 < 3 ? v[word + 1] : 0u);
+    return static_cast<uint16_t>((pair >> (64 - off - Width)) & RowMask);
+  }
+
+  constexpr void setRow(Value& v, int y, uint16_t bits)
+  {
+    const int start = y * Width;
+    const int word = start / 32;
+    const int off = start % 32;
+    const int shift = 64 - off - Width;
+    uint64_t pair = (uint64_t(v[word]) << 32) | (word + 1 < 3 ? v[word + 1] : 0u);
+    pair = (pair & ~(uint64_t(RowMask) << shift)) | (uint64_t(bits & RowMask) << shift);
+    v[word] = static_cast<uint32_t>(pair >> 32);
+    if (word + 1 < 3) v[word + 1] = static_cast<uint32_t>(pair);
+  }
+
+  // Columns l..r of a row.
+  constexpr uint16_t span(int l, int r)
+  {
+    return r < l ? 0 : static_cast<uint16_t>(((RowMask >> l) & (RowMask << (Width - 1 - r))) & RowMask);
+  }
+
+  constexpr uint16_t mirrorRow(uint16_t bits)
+  {
+    uint16_t out = 0;
+    for (int i = 0; i < Width; ++i)
+    {
+      out = static_cast<uint16_t>((out << 1) | ((bits >> i) & 1u));
+    }
+    return out;
+  }
+
+  constexpr Value mirrorX(const Value& v)
+  {
+    Value out{};
+    for (int y = 0; y < Height; ++y) setRow(out, y, mirrorRow(row(v, y)));
+    return out;
+  }
+
+  constexpr Value mirrorY(const Value& v)
+  {
+    Value out{};
+    for (int y = 0; y < Height; ++y) setRow(out, y, row(v, Height - 1 - y));
+    return out;
+  }
+
+  constexpr Value invert(const Value& v) { return Value{ ~v[0], ~v[1], ~v[2] }; }
+
+  // Move the picture by dx, dy (right, down); pixels shifted out are lost.
+  constexpr Value shift(const Value& v, int dx, int dy)
+  {
+    Value out{};
+    for (int y = 0; y < Height; ++y)
+    {
+      const int sy = y - dy;
+      if (sy < 0 || sy >= Height) continue;
+      const uint16_t r = row(v, sy);
+      setRow(out, y, static_cast<uint16_t>((dx >= 0 ? r >> dx : r << -dx) & RowMask));
+    }
+    return out;
+  }
+
+  // Pixels of v inside box.
+  constexpr Value clip(const Value& v, const Box& box)
+  {
+    Value out{};
+    if (box.r < box.l || box.b < box.t) return out;
+    const uint16_t mask = span(box.l, box.r);
+    for (int y = box.t; y <= box.b; ++y) setRow(out, y, row(v, y) & mask);
+    return out;
+  }
+
+  constexpr Box bbox(const Value& v)
+  {
+    uint16_t columns = 0;
+    int t = Height;
+    int b = -1;
+    for (int y = 0; y < Height; ++y)
+    {
+      const uint16_t r = row(v, y);
+      if (!r) continue;
+      columns |= r;
+      if (t == Height) t = y;
+      b = y;
+    }
+    if (!columns) return Box{ 0, 0, -1, -1 };
+    return Box{ __builtin_clz(columns) - (32 - Width), t, Width - 1 - __builtin_ctz(columns), b };
+  }
+
+  constexpr int count(const Value& v)
+  {
+    return __builtin_popcount(v[0]) + __builtin_popcount(v[1]) + __builtin_popcount(v[2]);
+  }
+
+  constexpr bool empty(const Value& v) { return (v[0] | v[1] | v[2]) == 0; }
+
+  constexpr bool equal(const Value& a, const Value& b)
+  {
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+  }
+
+  constexpr bool equal(const Box& a, const Box& b)
+  {
+    return a.l == b.l && a.t == b.t && a.r == b.r && a.b == b.b;
+  }
+
+  // Calls f(index) for each lit pixel in scan order; f returning false stops.
+  template <typename F>
+  constexpr void forEach(const Value& v, F&& f)
+  {
+    for (int w = 0; w < 3; ++w)
+    {
+      for (uint32_t bits = v[w]; bits; )
+      {
+        const int b = __builtin_clz(bits);
+        bits &= ~(0x80000000u >> b);
+        if (!f(w * 32 + b)) return;
+      }
+    }
+  }
+}
+
+/*
+Golden checks. The pattern lights (0,0), (11,0), (3,2), (6,5), (5,7) and
+(11,7); rows 2 and 5 straddle word boundaries.
+*/
+namespace MatrixR4Bits
+{
+  namespace Golden
+  {
+    constexpr Value Pattern = { 0x80100010u, 0x00000000u, 0x20000041u };
+    constexpr Value Row5    = { 0x00000000u, 0x0000000Fu, 0xFF000000u };
+  }
+
+  static_assert(row(Golden::Pattern, 0) == 0x801 && row(Golden::Pattern, 2) == 0x100 &&
+                row(Golden::Pattern, 5) == 0x020 && row(Golden::Pattern, 7) == 0x041,
+                "row() extracts 12 bits, x = 0 in bit 11");
+  static_assert(equal([] { Value v{}; setRow(v, 5, RowMask); return v; }(), Golden::Row5),
+                "setRow() across a word boundary");
+  static_assert(equal(mirrorX(Golden::Pattern), Value{ 0x80100000u, 0x80000000u, 0x40000820u }),
+                "mirrorX()");
+  static_assert(equal(mirrorY(Golden::Pattern), Value{ 0x04100002u, 0x00000001u, 0x00000801u }),
+                "mirrorY()");
+  static_assert(equal(shift(Golden::Pattern, 1, 1), Value{ 0x00040000u, 0x00800000u, 0x00010000u }),
+                "shift() right and down");
+  static_assert(equal(shift(Golden::Pattern, -2, -1), Value{ 0x00040000u, 0x00000800u, 0x00104000u }),
+                "shift() left and up");
+  static_assert(equal(clip(Golden::Pattern, Box{ 2, 1, 6, 7 }), Value{ 0x00000010u, 0x00000000u, 0x20000040u }),
+                "clip()");
+  static_assert(equal(bbox(Golden::Pattern), Box{ 0, 0, 11, 7 }) &&
+                equal(bbox(clip(Golden::Pattern, Box{ 2, 1, 6, 7 })), Box{ 3, 2, 6, 7 }) &&
+                equal(bbox(Value{}), Box{ 0, 0, -1, -1 }),
+                "bbox()");
+  static_assert(count(Golden::Pattern) == 6, "count()");
+}
@@ -2,9 +2,12 @@
 
 #include "../PinIO/TaskThunk.h"
 #include <Arduino_LED_Matrix.h>
+#include <atomic>
 #include "../ble/IDBTCharacteristic.h"
+#include "../ble/BLEWriteLock.h"
 
 #include "MatrixR4Value.h"
+#include "MatrixR4Transitions.h"
 
 /*
 Hardware:
@@ -13,6 +16,8 @@ Arduino UNO R4 WiFi
 struct MatrixR4DTraitsDft
 {
 	constexpr static const char* bleProperty = "07020000";
+	constexpr static const char* transitionProperty = "07010000";
+	constexpr static MatrixR4Transitions::Kind transition = MatrixR4Transitions::Kind::Animate;
 	constexpr static bool flipY = false;
 	constexpr static bool flipX = false;
 	constexpr static bool invert = false;
@@ -30,10 +35,11 @@ public:
   : _current(Traits::invert)
   , _showing()
   , _callback(callback)
-  , _displayChar(ble, Traits::bleProperty, _current.size(), _current.data(), bleUpdate)
+  , _displayChar(ble, this, &_current.value(), DisplayCharDesc{})
+  , _transition(static_cast<uint8_t>(Traits::transition))
+  , _transitionChar(ble, this, &_transition, TransitionCharDesc{})
   , _animationTask(scheduler, Traits::animateMS, this, false)
   {
-    matrixRefR4 = this;
   }
 
   void begin()
@@ -43,9 +49,15 @@ public:
     _matrix.loadFrame(_showing.data());
   }
 
+  // May run on the BLE host task; _current is shared with the animation.
   void update(const MatrixR4Value::Value& value, bool fromBLE = false)
   {
-    if (_current.update(value, Traits::flipY, Traits::flipX, Traits::invert))
+    bool changed;
+    {
+      BLEWriteLock::Guard guard(_lock);
+      changed = _current.update(value, Traits::flipY, Traits::flipX, Traits::invert);
+    }
+    if (changed)
     {
       if (fromBLE)
       {
@@ -53,66 +65,97 @@ public:
       }
       else
       {
-        _displayChar.ble.writeValue(value.data(), _current.size());
+        _displayChar.writeValue(value.data(), _current.size());
       }
       startAnimation();
     }
   }
 
 private:
+  void bleUpdate(const MatrixR4Value::Value& value)
+  {
+    update(value, true);
+  }
+
+  // Takes effect from the next update; unknown kinds are refused.
+  void bleTransition(const uint8_t& kind)
+  {
+    if (MatrixR4Transitions::valid(kind)) _transition = kind;
+    _transitionChar.writeValue(_transition);
+  }
+
+  struct DisplayCharDesc
+  {
+    using Obj = MatrixR4Display;
+    using Value = MatrixR4Value::Value;
+    static constexpr const char* property = Traits::bleProperty;
+    static constexpr bool notify = true;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::bleUpdate;
+  };
+
+  struct TransitionCharDesc
+  {
+    using Obj = MatrixR4Display;
+    using Value = uint8_t;
+    static constexpr const char* property = Traits::transitionProperty;
+    static constexpr bool notify = true;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::bleTransition;
+  };
+
   Value _current;
   Value _showing;
   Callback _callback;
   IDBTCharacteristic _displayChar;
+  uint8_t _transition;
+  IDBTCharacteristic _transitionChar;
   TaskThunk _animationTask;
 
   ArduinoLEDMatrix _matrix;
-  MatrixR4Value::Frames _frames{};
-  int  _frameCount = 0;
-  int  _frameIndex = 0;
-  bool _animating  = false;
+  MatrixR4Transitions _transitions;
+  std::atomic<bool> _restart{false};
+  BLEWriteLock _lock;
 
-  inline static MatrixR4Display* matrixRefR4 = nullptr;
-  static void bleUpdate(BLEDevice, BLECharacteristic characteristic)
+  Value current()
   {
-    MatrixR4Value::Value value;
-    characteristic.readValue(value.data(), sizeof(value));
-    matrixRefR4->update(value, true);
+    BLEWriteLock::Guard guard(_lock);
+    return _current;
   }
 
+  // The animation is set up on the next tick, not in the caller (often the
+  // BLE write callback).
   void startAnimation()
   {
-    _frameCount = 0;
-    _frameIndex = 0;
-    if (Traits::animateMS > 0) _showing.animateTo(_current, _frames, _frameCount);
-
-    if (_frameCount == 0)
+    if (Traits::animateMS > 0)
     {
-      _showing = _current;
-      _animating = false;
-      _animationTask.disable();
-      _matrix.loadFrame(_showing.data());
+      _restart = true;
+      SBJ_LATENCY_DEFERRED();
+      _animationTask.enable();
     }
     else
     {
-      _animating = true;
-      _animationTask.enable();
-	}
+      _showing = current();
+      _matrix.loadFrame(_showing.data());
+      SBJ_LATENCY_ACTUATED();
+    }
   }
 
   virtual void loop(Task&) override
   {
-    if (!_animating) return;
-    if (_frameIndex < _frameCount)
+    if (_restart.exchange(false))
+    {
+      SBJ_LATENCY_DISPATCHED();
+      _transitions.start(_showing.value(), current().value(), static_cast<MatrixR4Transitions::Kind>(_transition));
+    }
+    MatrixR4Value::Value frame;
+    if (_transitions.next(frame))
     {
-      _matrix.loadFrame(_frames[_frameIndex].data());
-      _showing = _frames[_frameIndex];
-      ++_frameIndex;
+      _matrix.loadFrame(frame.data());
+      SBJ_LATENCY_ACTUATED();
+      _showing = MatrixR4Value(frame);
     }
-    if (_frameIndex >= _frameCount)
+    if (!_transitions.active())
     {
-      _showing = _current;
-      _animating = false;
+      _showing = current();
       _animationTask.disable();
     }
   }
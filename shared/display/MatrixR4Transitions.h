@@ -0,0 +1,266 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "MatrixR4Bits.h"
+#include "MatrixR4Animator.h"
+
+/*
+Frame masks for the fixed transitions, built at compile time. They are
+constexpr data, so on the UNO R4 they stay in flash (about 530 bytes).
+
+A mask frame shows the destination where the mask is set and the source
+elsewhere; a sparkle frame additionally toggles a few scattered pixels.
+*/
+namespace MatrixR4TransitionTables
+{
+  using Value = MatrixR4Bits::Value;
+
+  constexpr int Pixels = MatrixR4Bits::Width * MatrixR4Bits::Height;
+  constexpr int DissolveFrames = 12;
+  constexpr int SparklePixels = 6;
+
+  constexpr uint32_t xorshift(uint32_t x)
+  {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+  }
+
+  constexpr void light(Value& v, int index)
+  {
+    v[index / 32] |= 0x80000000u >> (index % 32);
+  }
+
+  // Frame k shows columns 0..k.
+  constexpr std::array<Value, MatrixR4Bits::Width> wipeLeft()
+  {
+    std::array<Value, MatrixR4Bits::Width> out{};
+    for (int k = 0; k < MatrixR4Bits::Width; ++k)
+    {
+      for (int y = 0; y < MatrixR4Bits::Height; ++y) MatrixR4Bits::setRow(out[k], y, MatrixR4Bits::span(0, k));
+    }
+    return out;
+  }
+
+  // Frame k shows rows 0..k.
+  constexpr std::array<Value, MatrixR4Bits::Height> wipeDown()
+  {
+    std::array<Value, MatrixR4Bits::Height> out{};
+    for (int k = 0; k < MatrixR4Bits::Height; ++k)
+    {
+      for (int y = 0; y <= k; ++y) MatrixR4Bits::setRow(out[k], y, MatrixR4Bits::RowMask);
+    }
+    return out;
+  }
+
+  // Fisher-Yates over the pixel indices with a fixed seed.
+  constexpr std::array<uint8_t, Pixels> permutation(uint32_t seed)
+  {
+    std::array<uint8_t, Pixels> p{};
+    for (int i = 0; i < Pixels; ++i) p[i] = static_cast<uint8_t>(i);
+    uint32_t r = seed;
+    for (int i = Pixels - 1; i > 0; --i)
+    {
+      r = xorshift(r);
+      const int j = static_cast<int>(r % uint32_t(i + 1));
+      const uint8_t t = p[i];
+      p[i] = p[j];
+      p[j] = t;
+    }
+    return p;
+  }
+
+  // Frame k shows the first (k + 1) / DissolveFrames of the permutation.
+  constexpr std::array<Value, DissolveFrames> dissolve()
+  {
+    constexpr std::array<uint8_t, Pixels> order = permutation(0x2545F491u);
+    std::array<Value, DissolveFrames> out{};
+    Value m{};
+    int n = 0;
+    for (int k = 0; k < DissolveFrames; ++k)
+    {
+      for (const int end = (k + 1) * Pixels / DissolveFrames; n < end; ++n) light(m, order[n]);
+      out[k] = m;
+    }
+    return out;
+  }
+
+  // A few pixels per frame to toggle on top of the dissolve; none on the last.
+  constexpr std::array<Value, DissolveFrames> sparkle()
+  {
+    std::array<Value, DissolveFrames> out{};
+    uint32_t r = 0x9E3779B9u;
+    for (int k = 0; k + 1 < DissolveFrames; ++k)
+    {
+      for (int i = 0; i < SparklePixels; ++i)
+      {
+        r = xorshift(r);
+        light(out[k], static_cast<int>(r % Pixels));
+      }
+    }
+    return out;
+  }
+
+  inline constexpr std::array<Value, MatrixR4Bits::Width>  WipeLeft = wipeLeft();
+  inline constexpr std::array<Value, MatrixR4Bits::Height> WipeDown = wipeDown();
+  inline constexpr std::array<Value, DissolveFrames>       Dissolve = dissolve();
+  inline constexpr std::array<Value, DissolveFrames>       Sparkle  = sparkle();
+
+  constexpr bool isPermutation(const std::array<uint8_t, Pixels>& p)
+  {
+    std::array<bool, Pixels> seen{};
+    for (uint8_t i : p)
+    {
+      if (i >= Pixels || seen[i]) return false;
+      seen[i] = true;
+    }
+    return true;
+  }
+
+  // Each frame shows at least what the one before it did.
+  template <size_t N>
+  constexpr bool grows(const std::array<Value, N>& masks)
+  {
+    for (size_t k = 1; k < N; ++k)
+    {
+      for (size_t w = 0; w < masks[k].size(); ++w)
+      {
+        if (masks[k - 1][w] & ~masks[k][w]) return false;
+      }
+    }
+    return true;
+  }
+
+  constexpr Value AllOn = { ~0u, ~0u, ~0u };
+
+  static_assert(isPermutation(permutation(0x2545F491u)), "dissolve order must light every pixel once");
+  static_assert(WipeLeft.size() == MatrixR4Bits::Width && WipeDown.size() == MatrixR4Bits::Height,
+                "one wipe frame per column or row");
+  static_assert(MatrixR4Bits::equal(WipeLeft.back(), AllOn) && MatrixR4Bits::equal(WipeDown.back(), AllOn) &&
+                MatrixR4Bits::equal(Dissolve.back(), AllOn),
+                "the last mask shows the whole destination");
+  static_assert(grows(WipeLeft) && grows(WipeDown) && grows(Dissolve), "masks only ever add pixels");
+  static_assert(MatrixR4Bits::count(Dissolve[0]) == Pixels / DissolveFrames, "dissolve lights an even share per frame");
+  static_assert(MatrixR4Bits::empty(Sparkle.back()), "no sparkle on the last frame");
+}
+
+/*
+Transition between two matrix values, one frame per next() call, with the
+same interface as MatrixR4Animator. Animate runs that animator; the others
+render from the flash tables (or, for scrolls, row shifts) with a few word
+operations per frame. Every transition ends on the destination itself.
+*/
+class MatrixR4Transitions
+{
+public:
+  using Value = MatrixR4Bits::Value;
+
+  enum class Kind : uint8_t
+  {
+    Animate,    // shrink and move
+    Cut,
+    WipeLeft,
+    WipeDown,
+    Dissolve,
+    ScrollLeft,
+    ScrollUp,
+    Sparkle,
+    Count
+  };
+
+  static constexpr bool valid(uint8_t kind) { return kind < static_cast<uint8_t>(Kind::Count); }
+
+  // Frames before the destination itself, for src != dst. Animate depends
+  // on the values (see MatrixR4Animator) and reports 0, like Cut.
+  static int frames(Kind kind)
+  {
+    switch (kind)
+    {
+      case Kind::WipeLeft:   return int(MatrixR4TransitionTables::WipeLeft.size()) - 1;
+      case Kind::WipeDown:   return int(MatrixR4TransitionTables::WipeDown.size()) - 1;
+      case Kind::Dissolve:   return int(MatrixR4TransitionTables::Dissolve.size()) - 1;
+      case Kind::ScrollLeft: return MatrixR4Bits::Width - 1;
+      case Kind::ScrollUp:   return MatrixR4Bits::Height - 1;
+      case Kind::Sparkle:    return int(MatrixR4TransitionTables::Sparkle.size()) - 1;
+      default:               return 0;
+    }
+  }
+
+  bool active() const { return _kind == Kind::Animate ? _animator.active() : _steps >= 0; }
+
+  void start(const Value& src, const Value& dst, Kind kind)
+  {
+    _kind = kind;
+    if (_kind == Kind::Animate)
+    {
+      _animator.start(src, dst);
+      return;
+    }
+    _src = src;
+    _dst = dst;
+    _step = 0;
+    _steps = src == dst ? 0 : frames(kind);
+  }
+
+  // Writes the next frame; false once the destination has been produced.
+  bool next(Value& frame)
+  {
+    if (_kind == Kind::Animate) return _animator.next(frame);
+    if (_steps < 0) return false;
+    if (_step >= _steps)
+    {
+      frame = _dst;
+      _steps = -1;
+      return true;
+    }
+    frame = render(_step++);
+    return true;
+  }
+
+private:
+  MatrixR4Animator _animator;
+  Value _src{};
+  Value _dst{};
+  int   _step = 0;
+  int   _steps = -1;
+  Kind  _kind = Kind::Animate;
+
+  static Value blend(const Value& a, const Value& b, const Value& mask)
+  {
+    return Value{
+      (a[0] & ~mask[0]) | (b[0] & mask[0]),
+      (a[1] & ~mask[1]) | (b[1] & mask[1]),
+      (a[2] & ~mask[2]) | (b[2] & mask[2])
+    };
+  }
+
+  static Value merge(const Value& a, const Value& b)
+  {
+    return Value{ a[0] | b[0], a[1] | b[1], a[2] | b[2] };
+  }
+
+  Value render(int k) const
+  {
+    using namespace MatrixR4TransitionTables;
+    switch (_kind)
+    {
+      case Kind::WipeLeft: return blend(_src, _dst, WipeLeft[k]);
+      case Kind::WipeDown: return blend(_src, _dst, WipeDown[k]);
+      case Kind::Dissolve: return blend(_src, _dst, Dissolve[k]);
+      case Kind::Sparkle:
+      {
+        const Value f = blend(_src, _dst, Dissolve[k]);
+        return Value{ f[0] ^ Sparkle[k][0], f[1] ^ Sparkle[k][1], f[2] ^ Sparkle[k][2] };
+      }
+      case Kind::ScrollLeft:
+        return merge(MatrixR4Bits::shift(_src, -(k + 1), 0), MatrixR4Bits::shift(_dst, MatrixR4Bits::Width - 1 - k, 0));
+      case Kind::ScrollUp:
+        return merge(MatrixR4Bits::shift(_src, 0, -(k + 1)), MatrixR4Bits::shift(_dst, 0, MatrixR4Bits::Height - 1 - k));
+      default:
+        return _dst;
+    }
+  }
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TheFS.h"
+#include "../ble/BLEBulkTransfer.h"
+
+/*
+BLEBulkTransfer sink writing into TheFS (usually TheSDCard). Data lands in
+"<name>.part" and is renamed over "<name>" only once the CRC matched, so a
+dropped link leaves the previous file intact and the .part resumable.
+*/
+class TheFSBulkSink : public BLEBulkSink
+{
+public:
+  virtual int32_t open(const char* name, uint32_t size, bool resume) override
+  {
+    if (!TheFS::_fs || name == nullptr || name[0] != '/') return -1;
+    close(false);
+
+    snprintf(_path, sizeof(_path), "%s", name);
+    snprintf(_partPath, sizeof(_partPath), "%s.part", name);
+
+    fs::FS& fs = TheFS::fs();
+    if (!resume && fs.exists(_partPath))
+    {
+      fs.remove(_partPath);
+    }
+    _file = fs.open(_partPath, FILE_APPEND);
+    if (!_file) return -1;
+    return static_cast<int32_t>(_file.size());
+  }
+
+  virtual bool write(const uint8_t* data, size_t length) override
+  {
+    return _file && _file.write(data, length) == length;
+  }
+
+  // Flush the append handle first so the reader sees every byte written.
+  virtual size_t read(uint32_t offset, uint8_t* data, size_t length) override
+  {
+    if (_file) _file.flush();
+    File in = TheFS::fs().open(_partPath, FILE_READ);
+    if (!in || !in.seek(offset)) return 0;
+    const size_t got = in.read(data, length);
+    in.close();
+    return got;
+  }
+
+  virtual bool close(bool commit) override
+  {
+    if (!_file) return false;
+    _file.close();
+    if (!commit) return true; // keep the .part for a resume
+
+    fs::FS& fs = TheFS::fs();
+    if (fs.exists(_path)) fs.remove(_path);
+    return fs.rename(_partPath, _path);
+  }
+
+private:
+  File _file;
+  char _path[BLEBulkTransferTraitsDft::maxName + 2] = {};
+  char _partPath[BLEBulkTransferTraitsDft::maxName + 7] = {};
+};
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../core/LegoPFIR.h"
+#include "LegoPFIR.h"
 #include "../ble/IDBTCharacteristic.h"
 
 class LEGOPFTransmitter : ScheduledRunner {
@@ -12,9 +12,19 @@ public:
 private:
   LegoPFIR _ir;
   LegoPFIR::Command _value;
+  void transmit(const std::array<uint8_t, 4>& value);
+
+  struct TransmitDesc
+  {
+    using Obj = LEGOPFTransmitter;
+    using Value = std::array<uint8_t, 4>;
+    static constexpr const char* property = "05020000";
+    static constexpr bool notify = false;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::transmit;
+  };
+
   IDBTCharacteristic _transmitChar;
   TaskThunk _task;
 
-  static void transmit(BLEDevice device, BLECharacteristic characteristic);
   virtual void loop(Task&);
 };
@@ -1,4 +1,5 @@
 #include "LegoPFIR.h"
+#include "../PinIO/SBJCpuBoost.h"
 
 LegoPFIR::LegoPFIR(uint8_t irPin)
 : _irPin(irPin) {
@@ -20,6 +21,8 @@ bool LegoPFIR::apply(const Command& cmd, uint8_t repeats, uint16_t repeatDelayMs
   if (cmd.value > 15) return false;
 
   const uint8_t idx = cmd.channel - 1;
+  // Bit-banged 38kHz carrier; keep the clock steady for the whole burst
+  SBJCpuBoost boost;
 
   // Update cached A/B value
   if (cmd.port == Port::A) _a[idx] = cmd.value;
@@ -69,6 +72,7 @@ bool LegoPFIR::sendChannel(uint8_t channel, uint8_t repeats, uint16_t repeatDela
 }
 
 void LegoPFIR::refreshAll(uint16_t interChannelDelayMs) {
+  SBJCpuBoost boost;
   for (uint8_t ch = 1; ch <= 4; ch++) {
     (void)sendChannel(ch, 1, 0);
     if (interChannelDelayMs) delay(interChannelDelayMs);
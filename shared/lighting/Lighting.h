@@ -25,13 +25,49 @@ private:
   uint8_t _currentAmbient;
   uint8_t _currentSignal;
   
+  void updatePower(const uint8_t& value);
+  void updateCalibration(const uint8_t& value);
+  void updateSensed(const uint8_t& value);
+
+  struct PowerControlDesc
+  {
+    using Obj = Lighting;
+    using Value = uint8_t;
+    static constexpr const char* property = "03020001";
+    static constexpr bool notify = false;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::updatePower;
+  };
+
+  struct CalibrationDesc
+  {
+    using Obj = Lighting;
+    using Value = uint8_t;
+    static constexpr const char* property = "03010000";
+    static constexpr bool notify = true;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::updateCalibration;
+  };
+
+  struct SensedDesc
+  {
+    using Obj = Lighting;
+    using Value = uint8_t;
+    static constexpr const char* property = "03040002";
+    static constexpr bool notify = true;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::updateSensed;
+  };
+
+  // The photo sensor jitters by a count or two; hold notifies to real changes.
+  struct AmbientNotifyPolicy
+  {
+    static constexpr long     deadband      = 2;
+    static constexpr uint32_t minIntervalMs = 250;
+    static constexpr uint32_t maxStaleMs    = 10000;
+  };
+
   IDBTCharacteristic _powerControlChar;
   IDBTCharacteristic _powerFeedbackChar;
   IDBTCharacteristic _calibrationChar;
-  IDBTCharacteristic _sensedFeedbackChar;
-  static void updatePower(BLEDevice device, BLECharacteristic characteristic);
-  static void updateCalibration(BLEDevice device, BLECharacteristic characteristic);
-  static void updateSensed(BLEDevice device, BLECharacteristic characteristic);
+  IDBTValue<uint8_t, AmbientNotifyPolicy> _sensedFeedbackChar;
 
   virtual void loop(Task&);
   TaskThunk _lightingTask;
@@ -28,11 +28,30 @@ private:
   const int _signalMax = 180;
   int _currentSignal;
   
+  void updatePower(const int8_t& value);
+  void updateCalibration(const uint8_t& value);
+
+  struct PowerControlDesc
+  {
+    using Obj = ServoMotor;
+    using Value = int8_t;
+    static constexpr const char* property = "02020001";
+    static constexpr bool notify = false;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::updatePower;
+  };
+
+  struct CalibrationDesc
+  {
+    using Obj = ServoMotor;
+    using Value = uint8_t;
+    static constexpr const char* property = "02010000";
+    static constexpr bool notify = true;
+    static constexpr void (Obj::*Method)(const Value&) = &Obj::updateCalibration;
+  };
+
   IDBTCharacteristic _powerControlChar;
   IDBTCharacteristic _powerFeedbackChar;
   IDBTCharacteristic _calibrationChar;
-  static void updatePower(BLEDevice device, BLECharacteristic characteristic);
-  static void updateCalibration(BLEDevice device, BLECharacteristic characteristic);
 
   Servo _motor;
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <MFRC522.h>
+#include <algorithm>
+
+#include "RC522Driver.h"
+
+/*
+The MFRC522 library behind the RC522Driver interface, for comparison or
+when the library's conservative timing is wanted. Include this header
+before the traits that select it; RFIDDetector does not, so sketches on
+RC522Driver build without the library.
+*/
+class MFRC522Reader
+{
+public:
+  MFRC522Reader(uint8_t ssPin, uint8_t rstPin)
+  : _rfid(ssPin, rstPin)
+  {
+  }
+
+  void init() { _rfid.PCD_Init(); }
+  void antennaGainMax() { _rfid.PCD_SetAntennaGain(_rfid.RxGain_max); }
+  bool requestA() { return _rfid.PICC_IsNewCardPresent(); }
+
+  bool readUid(RC522::Uid& uid)
+  {
+    if (!_rfid.PICC_ReadCardSerial()) return false;
+    uid.size = _rfid.uid.size > 10 ? 10 : _rfid.uid.size;
+    std::copy(_rfid.uid.uidByte, _rfid.uid.uidByte + uid.size, uid.bytes);
+    uid.sak = _rfid.uid.sak;
+    return true;
+  }
+
+  bool authenticate(const RC522::Uid&, uint8_t block, const uint8_t* keyA)
+  {
+    MFRC522::MIFARE_Key key;
+    std::copy(keyA, keyA + 6, key.keyByte);
+    return _rfid.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, block, &key, &_rfid.uid) == MFRC522::STATUS_OK;
+  }
+
+  bool read16(uint8_t address, uint8_t* out)
+  {
+    uint8_t buffer[18];
+    uint8_t size = sizeof(buffer);
+    if (_rfid.MIFARE_Read(address, buffer, &size) != MFRC522::STATUS_OK) return false;
+    std::copy(buffer, buffer + 16, out);
+    return true;
+  }
+
+  void haltA()
+  {
+    _rfid.PICC_HaltA();
+    _rfid.PCD_StopCrypto1();
+  }
+
+  uint8_t readRegister(uint8_t reg) { return _rfid.PCD_ReadRegister(address(reg)); }
+  void writeRegister(uint8_t reg, uint8_t value) { _rfid.PCD_WriteRegister(address(reg), value); }
+
+private:
+  MFRC522 _rfid;
+
+  static MFRC522::PCD_Register address(uint8_t reg) { return static_cast<MFRC522::PCD_Register>(reg << 1); }
+};
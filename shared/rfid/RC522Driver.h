@@ -0,0 +1,333 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <cstring>
+
+/*
+Lean RC522 driver for UID-only reads: REQA, anticollision and select
+through the cascade levels, HLTA; plus key A authentication and READ for
+the occasional payload block. At speed a tag is in the field for a
+few milliseconds, so compared to the MFRC522 library it
+- runs SPI at spiHz (the RC522 is rated to 10 MHz),
+- moves FIFO data in one burst per transaction,
+- times out after timeoutUs rather than ~25 ms, both in the RC522 timer
+  and on the host side,
+- computes CRC_A in software instead of a CalcCRC round trip.
+
+Registers are the datasheet numbers; the SPI address shift is done here.
+*/
+namespace RC522
+{
+  enum Reg : uint8_t
+  {
+    CommandReg = 0x01, ComIEnReg = 0x02, DivIEnReg = 0x03, ComIrqReg = 0x04,
+    DivIrqReg = 0x05, ErrorReg = 0x06, Status2Reg = 0x08, FIFODataReg = 0x09,
+    FIFOLevelReg = 0x0A, ControlReg = 0x0C, BitFramingReg = 0x0D, CollReg = 0x0E,
+    ModeReg = 0x11, TxModeReg = 0x12, RxModeReg = 0x13, TxControlReg = 0x14,
+    TxASKReg = 0x15, ModWidthReg = 0x24, RFCfgReg = 0x26, TModeReg = 0x2A,
+    TPrescalerReg = 0x2B, TReloadRegH = 0x2C, TReloadRegL = 0x2D, VersionReg = 0x37
+  };
+
+  enum Cmd : uint8_t { Idle = 0x00, CalcCRC = 0x03, Transceive = 0x0C, MFAuthent = 0x0E, SoftReset = 0x0F };
+
+  enum Picc : uint8_t
+  {
+    REQA = 0x26, SelCL1 = 0x93, SelCL2 = 0x95, SelCL3 = 0x97, HLTA = 0x50, CascadeTag = 0x88,
+    MFAuthKeyA = 0x60, Read = 0x30
+  };
+
+  enum class Status : uint8_t { Ok, Timeout, Error, Collision, Overflow, CrcError };
+
+  struct Uid
+  {
+    uint8_t size = 0;
+    uint8_t bytes[10] = {};
+    uint8_t sak = 0;
+  };
+
+  // SAK of MIFARE Classic (Mini, 1K, 4K); Ultralight and NTAG answer 0x00.
+  constexpr bool isMifareClassic(uint8_t sak) { return (sak & 0x08) != 0; }
+
+  // ISO/IEC 14443-3 CRC_A, transmitted low byte first.
+  constexpr uint16_t crcA(const uint8_t* data, size_t length)
+  {
+    uint16_t crc = 0x6363;
+    for (size_t i = 0; i < length; ++i)
+    {
+      uint8_t b = data[i] ^ static_cast<uint8_t>(crc);
+      b ^= static_cast<uint8_t>(b << 4);
+      crc = static_cast<uint16_t>((crc >> 8) ^ (uint16_t(b) << 8) ^ (uint16_t(b) << 3) ^ (b >> 4));
+    }
+    return crc;
+  }
+}
+
+struct RC522DriverTraitsDft
+{
+  static constexpr uint32_t spiHz     = 10000000;
+  static constexpr uint32_t timeoutUs = 1000; // ATQA and SAK arrive within ~100 us
+  static constexpr uint32_t authTimeoutUs = 5000;
+};
+
+template <typename Traits = RC522DriverTraitsDft>
+class RC522Driver
+{
+public:
+  // RST is left to the owner, see RFIDDetector::resetRc522.
+  RC522Driver(uint8_t ssPin, uint8_t /*rstPin*/)
+  : _ssPin(ssPin)
+  {
+  }
+
+  // Soft reset and configure; RST is expected high.
+  void init()
+  {
+    pinMode(_ssPin, OUTPUT);
+    digitalWrite(_ssPin, HIGH);
+    SPI.begin();
+    writeRegister(RC522::CommandReg, RC522::SoftReset);
+    const uint32_t start = millis();
+    while ((readRegister(RC522::CommandReg) & 0x10) && millis() - start < 50) // PowerDown
+    {
+      delay(1);
+    }
+    writeRegister(RC522::TxModeReg, 0x00);
+    writeRegister(RC522::RxModeReg, 0x00);
+    writeRegister(RC522::ModWidthReg, 0x26);
+    // TAuto, 13.56 MHz / (2 * 67 + 1): ~10 us per timer tick
+    writeRegister(RC522::TModeReg, 0x80);
+    writeRegister(RC522::TPrescalerReg, 67);
+    writeRegister(RC522::TReloadRegH, static_cast<uint8_t>(TimerReload >> 8));
+    writeRegister(RC522::TReloadRegL, static_cast<uint8_t>(TimerReload));
+    writeRegister(RC522::TxASKReg, 0x40); // 100% ASK
+    writeRegister(RC522::ModeReg, 0x3D);  // CRC preset 0x6363
+    writeRegister(RC522::TxControlReg, readRegister(RC522::TxControlReg) | 0x03); // antenna on
+  }
+
+  void antennaGainMax()
+  {
+    writeRegister(RC522::RFCfgReg, (readRegister(RC522::RFCfgReg) & ~0x70) | 0x70);
+  }
+
+  // REQA; true when a card in IDLE answers with an ATQA.
+  bool requestA()
+  {
+    writeRegister(RC522::CollReg, readRegister(RC522::CollReg) & 0x7F);
+    const uint8_t reqa = RC522::REQA;
+    uint8_t atqa[2];
+    size_t received = sizeof(atqa);
+    uint8_t lastBits = 0;
+    return transceive(&reqa, 1, atqa, received, 7, 0, lastBits) == RC522::Status::Ok
+      && received == 2 && lastBits == 0;
+  }
+
+  // Anticollision and select through all cascade levels of a READY card.
+  bool readUid(RC522::Uid& uid)
+  {
+    uid.size = 0;
+    writeRegister(RC522::CollReg, readRegister(RC522::CollReg) & 0x7F);
+    static constexpr uint8_t sel[3] = { RC522::SelCL1, RC522::SelCL2, RC522::SelCL3 };
+    for (uint8_t level = 0; level < 3; ++level)
+    {
+      uint8_t frame[9] = { sel[level] };
+      if (!anticollision(frame)) return false;
+
+      frame[1] = 0x70;
+      const uint16_t crc = RC522::crcA(frame, 7);
+      frame[7] = static_cast<uint8_t>(crc);
+      frame[8] = static_cast<uint8_t>(crc >> 8);
+      uint8_t sak[3];
+      size_t received = sizeof(sak);
+      uint8_t lastBits = 0;
+      if (transceive(frame, 9, sak, received, 0, 0, lastBits) != RC522::Status::Ok || received != 3) return false;
+      if (RC522::crcA(sak, 3) != 0) return false; // CRC over data and CRC is zero
+
+      const bool cascade = frame[2] == RC522::CascadeTag;
+      const uint8_t* part = frame + (cascade ? 3 : 2);
+      const uint8_t count = cascade ? 3 : 4;
+      for (uint8_t i = 0; i < count; ++i) uid.bytes[uid.size++] = part[i];
+      uid.sak = sak[0];
+      if (!(sak[0] & 0x04)) return true; // UID complete
+    }
+    return false;
+  }
+
+  void haltA()
+  {
+    uint8_t frame[4] = { RC522::HLTA, 0x00 };
+    const uint16_t crc = RC522::crcA(frame, 2);
+    frame[2] = static_cast<uint8_t>(crc);
+    frame[3] = static_cast<uint8_t>(crc >> 8);
+    size_t received = 0;
+    uint8_t lastBits = 0;
+    transceive(frame, 4, nullptr, received, 0, 0, lastBits); // a halted card does not answer
+    writeRegister(RC522::Status2Reg, readRegister(RC522::Status2Reg) & ~0x08); // MFCrypto1On off
+  }
+
+  // MIFARE Classic key A authentication for block's sector; Crypto1 stays on
+  // until haltA().
+  bool authenticate(const RC522::Uid& uid, uint8_t block, const uint8_t* keyA)
+  {
+    if (uid.size < 4) return false;
+    uint8_t frame[12] = { RC522::MFAuthKeyA, block };
+    std::memcpy(frame + 2, keyA, 6);
+    std::memcpy(frame + 8, uid.bytes + uid.size - 4, 4);
+    writeRegister(RC522::CommandReg, RC522::Idle);
+    writeRegister(RC522::ComIrqReg, 0x7F);
+    writeRegister(RC522::FIFOLevelReg, 0x80);
+    writeFifo(frame, sizeof(frame));
+    writeRegister(RC522::CommandReg, RC522::MFAuthent);
+    const uint32_t start = micros();
+    while (!(readRegister(RC522::ComIrqReg) & 0x10)) // IdleIRq
+    {
+      if (micros() - start > Traits::authTimeoutUs) return false;
+    }
+    return (readRegister(RC522::ErrorReg) & 0x13) == 0
+      && (readRegister(RC522::Status2Reg) & 0x08); // MFCrypto1On
+  }
+
+  // READ: 16 bytes, one MIFARE Classic block or four NTAG pages.
+  bool read16(uint8_t address, uint8_t* out)
+  {
+    uint8_t frame[4] = { RC522::Read, address };
+    const uint16_t crc = RC522::crcA(frame, 2);
+    frame[2] = static_cast<uint8_t>(crc);
+    frame[3] = static_cast<uint8_t>(crc >> 8);
+    uint8_t back[18];
+    size_t received = sizeof(back);
+    uint8_t lastBits = 0;
+    if (transceive(frame, 4, back, received, 0, 0, lastBits) != RC522::Status::Ok || received != 18) return false;
+    if (RC522::crcA(back, 18) != 0) return false;
+    std::memcpy(out, back, 16);
+    return true;
+  }
+
+  uint8_t readRegister(uint8_t reg)
+  {
+    SPI.beginTransaction(settings());
+    digitalWrite(_ssPin, LOW);
+    SPI.transfer(0x80 | (reg << 1));
+    const uint8_t value = SPI.transfer(0);
+    digitalWrite(_ssPin, HIGH);
+    SPI.endTransaction();
+    return value;
+  }
+
+  void writeRegister(uint8_t reg, uint8_t value)
+  {
+    SPI.beginTransaction(settings());
+    digitalWrite(_ssPin, LOW);
+    SPI.transfer(reg << 1);
+    SPI.transfer(value);
+    digitalWrite(_ssPin, HIGH);
+    SPI.endTransaction();
+  }
+
+  // Data bytes follow the address in one transaction.
+  void writeFifo(const uint8_t* data, size_t length)
+  {
+    SPI.beginTransaction(settings());
+    digitalWrite(_ssPin, LOW);
+    SPI.transfer(RC522::FIFODataReg << 1);
+    for (size_t i = 0; i < length; ++i) SPI.transfer(data[i]);
+    digitalWrite(_ssPin, HIGH);
+    SPI.endTransaction();
+  }
+
+  // Each address byte clocks out the previous byte; 0 ends the burst.
+  void readFifo(uint8_t* data, size_t length)
+  {
+    if (length == 0) return;
+    const uint8_t address = 0x80 | (RC522::FIFODataReg << 1);
+    SPI.beginTransaction(settings());
+    digitalWrite(_ssPin, LOW);
+    SPI.transfer(address);
+    for (size_t i = 0; i < length; ++i) data[i] = SPI.transfer(i + 1 < length ? address : 0);
+    digitalWrite(_ssPin, HIGH);
+    SPI.endTransaction();
+  }
+
+  // One Transceive. received is the capacity in and the byte count out; the
+  // first received byte keeps its low rxAlign bits from back[0].
+  RC522::Status transceive(const uint8_t* send, size_t sendLength, uint8_t* back, size_t& received,
+                           uint8_t txLastBits, uint8_t rxAlign, uint8_t& rxLastBits)
+  {
+    const size_t capacity = received;
+    received = 0;
+    const uint8_t framing = static_cast<uint8_t>((rxAlign << 4) | txLastBits);
+    writeRegister(RC522::CommandReg, RC522::Idle);
+    writeRegister(RC522::ComIrqReg, 0x7F);
+    writeRegister(RC522::FIFOLevelReg, 0x80);
+    writeFifo(send, sendLength);
+    writeRegister(RC522::BitFramingReg, framing);
+    writeRegister(RC522::CommandReg, RC522::Transceive);
+    writeRegister(RC522::BitFramingReg, framing | 0x80); // StartSend
+
+    const uint32_t start = micros();
+    for (;;)
+    {
+      const uint8_t irq = readRegister(RC522::ComIrqReg);
+      if (irq & 0x30) break;                          // RxIRq, IdleIRq
+      if (irq & 0x01) return RC522::Status::Timeout;  // TimerIRq
+      if (micros() - start > Traits::timeoutUs + HostMarginUs + capacity * ByteUs) return RC522::Status::Timeout;
+    }
+
+    const uint8_t errors = readRegister(RC522::ErrorReg);
+    if (errors & 0x13) return RC522::Status::Error;  // BufferOvfl, ParityErr, ProtocolErr
+    const uint8_t level = readRegister(RC522::FIFOLevelReg);
+    if (level > capacity) return RC522::Status::Overflow;
+    if (level)
+    {
+      const uint8_t first = back[0];
+      readFifo(back, level);
+      if (rxAlign)
+      {
+        const uint8_t mask = static_cast<uint8_t>((1u << rxAlign) - 1);
+        back[0] = static_cast<uint8_t>((first & mask) | (back[0] & ~mask));
+      }
+    }
+    received = level;
+    rxLastBits = readRegister(RC522::ControlReg) & 0x07;
+    return (errors & 0x08) ? RC522::Status::Collision : RC522::Status::Ok;
+  }
+
+private:
+  static constexpr uint32_t HostMarginUs = 500;
+  static constexpr uint32_t ByteUs = 100; // 9 bits at 106 kbit/s, rounded up
+  static constexpr uint16_t TimerReload = static_cast<uint16_t>((Traits::timeoutUs + 9) / 10);
+
+  const uint8_t _ssPin;
+
+  static SPISettings settings() { return SPISettings(Traits::spiHz, MSBFIRST, SPI_MODE0); }
+
+  // frame: [SEL][NVB][4 UID bytes or CT + 3][BCC]. Fills the 5 bytes after
+  // SEL/NVB, choosing the 1 branch on each collision.
+  bool anticollision(uint8_t* frame)
+  {
+    uint8_t known = 0; // valid UID bits
+    for (uint8_t attempt = 0; attempt < 32; ++attempt)
+    {
+      const uint8_t bytes = known / 8;
+      const uint8_t bits = known % 8;
+      frame[1] = static_cast<uint8_t>(((2 + bytes) << 4) | bits);
+      size_t received = 5 - bytes;
+      uint8_t lastBits = 0;
+      const RC522::Status status = transceive(frame, 2 + bytes + (bits ? 1 : 0), frame + 2 + bytes, received, bits, bits, lastBits);
+      if (status == RC522::Status::Collision)
+      {
+        const uint8_t coll = readRegister(RC522::CollReg);
+        if (coll & 0x20) return false; // CollPosNotValid
+        uint8_t position = coll & 0x1F;
+        if (position == 0) position = 32;
+        if (position <= known) return false;
+        known = position;
+        frame[2 + (known - 1) / 8] |= static_cast<uint8_t>(1u << ((known - 1) % 8));
+        continue;
+      }
+      if (status != RC522::Status::Ok || bytes + received != 5) return false;
+      return (frame[2] ^ frame[3] ^ frame[4] ^ frame[5]) == frame[6]; // BCC
+    }
+    return false;
+  }
+};
@@ -2,6 +2,8 @@
 
 #include <array>
 
+#include "TagPayload.h"
+
 struct RFID {
   using ID = std::array<uint8_t, 10>;
   using Encoded = std::array<uint8_t, 4 + 4 + 1 + 10>;
@@ -9,6 +11,8 @@ struct RFID {
   RFID(uint8_t number)
   : _number(number)
   , _timestamp(0)
+  , _micros(0)
+  , _payload(nullptr)
   , _length(0)
   , _uuid({0})
   {
@@ -16,6 +20,8 @@ struct RFID {
 
   const uint8_t _number;
   uint32_t _timestamp;
+  uint32_t _micros;     // for timing between readers, not encoded
+  const TagPayload* _payload; // when read from the tag, valid during the callback
   uint8_t _length;
   ID _uuid;
 
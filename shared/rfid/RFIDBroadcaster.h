@@ -3,13 +3,20 @@
 #include "../PinIO/TaskThunk.h"
 #include "../ble/IDBTCharacteristic.h"
 #include "RFIDDetector.h"
+#include "RFIDPollRate.h"
 
 struct RFIDBroadcasterTraitsDft: RFIDDetectorTraitsDft
 {
   static constexpr const char* bleProperty = "01000002";
-  static constexpr uint32_t loopFrequencyMs = 20;
+  using PollRate = RFIDPollRateTraitsDft;    // adaptive, polled or IRQ driven
+  static constexpr uint32_t irqAnswerMs = 2; // arm to collect, past the RC522 timeout
 };
 
+/*
+Runs the detector at the PollRate interval. With an IRQ line each poll is
+two short runs irqAnswerMs apart, one arming a REQA and one collecting
+the answer, instead of one blocking exchange.
+*/
 template<typename Traits = RFIDBroadcasterTraitsDft>
 class RFIDBroadcaster : ScheduledRunner
 {
@@ -19,9 +26,10 @@ public:
 
   RFIDBroadcaster(Scheduler& scheduler, BLEServiceRunner& ble, Callback callback = nullptr)
   : _rfid()
+  , _initial(_rfid.lastID().encode())
   , _callback(callback)
-  , _idFeedbackChar(ble, writeIndex(Traits::bleProperty, Traits::Number), _rfid.lastID().encode())
-  , _rfidTask(scheduler, Traits::loopFrequencyMs, this)
+  , _idFeedbackChar(ble, writeIndex(Traits::bleProperty, Traits::Number).data(), _initial)
+  , _rfidTask(scheduler, _poll.interval(), this)
   {
   }
 
@@ -33,12 +41,35 @@ public:
     Serial.println();
   }
 
+  // Poll fast now: dock change, upstream detection.
+  void wake()
+  {
+    _poll.wake();
+    reschedule();
+  }
+
+  // Poll fast ahead of a predicted arrival.
+  void expect(uint32_t etaMs)
+  {
+    _poll.expect(etaMs);
+    reschedule();
+  }
+
 private:
   Detector _rfid;
+  RFID::Encoded _initial; // read later by NimBLE, so owned here
   Callback _callback;
   IDBTCharacteristic _idFeedbackChar;
+  RFIDPollRate<typename Traits::PollRate> _poll;
   TaskThunk _rfidTask;
 
+  // A pending collect keeps its short delay; the new rate applies after it.
+  void reschedule()
+  {
+    if (Detector::UseIrq && _rfid.armed()) return;
+    _rfidTask.setInterval(_poll.due());
+  }
+
   virtual void loop(Task&)
   {
     const RFID* detected = _rfid.loop();
@@ -52,7 +83,14 @@ private:
       Serial.println();
       //Serial.println(_idFeedbackChar.uuid.data());
       if (_callback) _callback(*detected);
-      _idFeedbackChar.ble.writeValue(encoded.data(), detected->encodedSize());
+      _idFeedbackChar.writeValue(encoded.data(), detected->encodedSize());
+    }
+    if (Detector::UseIrq && _rfid.armed())
+    {
+      _rfidTask.setInterval(Traits::irqAnswerMs);
+      return;
     }
+    const uint32_t interval = _poll.next(detected != nullptr);
+    if (interval != _rfidTask.interval()) _rfidTask.setInterval(interval);
   }
 };
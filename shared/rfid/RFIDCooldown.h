@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+/*
+Per-tag dedup window. Each distinct UID gets its own last-seen time, so
+two trains passing close together are both reported while a tag lingering
+in the field stays quiet: every sighting inside the window extends it.
+The table is small and fixed; a new tag replaces the least recently seen.
+*/
+template <size_t Capacity>
+class RFIDCooldown
+{
+public:
+  // True when uid should be reported; records the sighting either way.
+  bool admit(const uint8_t* uid, uint8_t length, uint32_t now, uint32_t windowMs)
+  {
+    Entry* oldest = &_entries[0];
+    for (Entry& e : _entries)
+    {
+      if (e.used && e.length == length && std::memcmp(e.uid.data(), uid, length) == 0)
+      {
+        const bool expired = now - e.lastSeenMs >= windowMs;
+        e.lastSeenMs = now;
+        return expired;
+      }
+      if (!e.used || (oldest->used && now - e.lastSeenMs > now - oldest->lastSeenMs))
+      {
+        oldest = &e;
+      }
+    }
+    oldest->used = true;
+    oldest->length = length;
+    std::memcpy(oldest->uid.data(), uid, length);
+    oldest->lastSeenMs = now;
+    return true;
+  }
+
+  void clear() { _entries = {}; }
+
+private:
+  struct Entry
+  {
+    std::array<uint8_t, 10> uid;
+    uint8_t  length;
+    bool     used;
+    uint32_t lastSeenMs;
+  };
+
+  std::array<Entry, Capacity> _entries{};
+};
@@ -3,7 +3,9 @@
 #include "RFID.h"
 #include "../PinIO/PinIO.h"
 
-#include <MFRC522.h>
+#include "RC522Driver.h"
+#include "RFIDCooldown.h"
+#include <atomic>
 
 /*
 Hardware:
@@ -11,37 +13,83 @@ HiLetgo 3pcs RFID Kit - Mifare RC522 RF IC Card Sensor Module + S50 Blank Card +
 Timeskey NFC 20 Pack Mifare Classic 1k NFC Tag RFID Sticker 13.56mhz - ISO14443A Smart 25mm Adhesive Tags
  */
 
+static constexpr uint8_t RFIDNoIrq = 0xFF;
+
+/*
+IRQ detection: with the RC522 IRQ pin wired to IrqPin, loop() alternates
+between arming a REQA without waiting and, on the next call, collecting
+the outcome: RxIRq (active low) latched by the interrupt when a card
+answered, or nothing once the RC522 timer has expired. A new REQA is only
+sent after the previous one was collected.
+
+Arming has to repeat: the RC522 has no autonomous card detection, and a
+card only answers a REQA sent while it is in the field. What the IRQ
+saves is the blocking exchange; an arm is 8 register accesses (16 SPI
+bytes) and no wait, against a polled REQA that spins up to timeoutUs
+when no card is there. The owner paces arms, see RFIDBroadcaster.
+*/
+template <uint8_t Pin>
+struct RFIDIrqFlag
+{
+  static inline std::atomic<bool> raised{false};
+  static void raise() { raised.store(true); }
+};
+
 struct RFIDDetectorTraitsDft {
   static constexpr uint8_t Number = 0;
   static constexpr uint8_t SsPin  = 10;
   using RstPin = PinIO<9, GpioMode::DigitalOut>;
+  static constexpr uint8_t IrqPin = RFIDNoIrq;
+  using Reader = RC522Driver<>;  // or MFRC522Reader, include MFRC522Reader.h for the library
 
-  static constexpr uint32_t cooldownMs      = 800;    // Tune for tag movement speed
+  static constexpr uint32_t cooldownMs      = 800;    // Per tag; tune for tag movement speed
+  static constexpr size_t   cooldownTags    = 8;      // Tags remembered for the cooldown
   static constexpr uint32_t reinitAfterMs   = 30000;  // MFRC522 goes bad after a while
   static constexpr uint8_t  failResetCount  = 5;      // Reset after repeated failures
+
+  // Optional metadata block, see TagPayload.h
+  static constexpr bool     readPayload     = false;
+  static constexpr size_t   payloadTags     = 8;      // Tags cached
+  static constexpr uint8_t  payloadTries    = 2;      // Before a tag counts as having none
+  static constexpr uint8_t  payloadBlock    = 4;      // MIFARE Classic, sector 1
+  static constexpr uint8_t  payloadPage     = 4;      // NTAG / Ultralight
+  static constexpr std::array<uint8_t, 6> payloadKeyA = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
 };
 
 template <typename Traits = RFIDDetectorTraitsDft>
 class RFIDDetector {
 public:
-  static constexpr uint8_t number  = Traits::Number;
-  static constexpr uint8_t ss_pin  = Traits::SsPin;
+  static constexpr bool UseIrq = Traits::IrqPin != RFIDNoIrq;
+
+  using Reader = typename Traits::Reader;
 
-  RFIDDetector()
-  : _rfid(Traits::SsPin, Traits::RstPin::pin)
-  , _lastID(Traits::Number)
-  , _cooldownLimitMs(0)
+  // Readers sharing the SPI bus differ in number and chip select only. With a
+  // shared RST line, sharedReset makes resets soft so the others keep running.
+  RFIDDetector(uint8_t number = Traits::Number, uint8_t ssPin = Traits::SsPin, bool sharedReset = false)
+  : _rfid(ssPin, Traits::RstPin::pin)
+  , _lastID(number)
   , _lastGoodReadMs(0)
   , _failReadCount(0)
+  , _sharedReset(sharedReset)
   {
   }
 
+  uint8_t number() const { return _lastID._number; }
+
+  // IRQ mode: a REQA is out and the next loop() collects its answer.
+  bool armed() const { return _armed; }
   const RFID& lastID() const { return _lastID; }
 
   void begin()
   {
     Traits::RstPin::begin(GpioLevel::High);
-    _rfid.PCD_Init();
+    _rfid.init();
+    if constexpr (UseIrq)
+    {
+      pinMode(Traits::IrqPin, INPUT_PULLUP);
+      attachInterrupt(digitalPinToInterrupt(Traits::IrqPin), &RFIDIrqFlag<Traits::IrqPin>::raise, FALLING);
+      enableIrq();
+    }
   }
 
   const RFID* loop()
@@ -53,31 +101,36 @@ public:
       resetRc522();
       _lastGoodReadMs = now;
     }
-    if (_rfid.PICC_IsNewCardPresent())
+    if (cardPresent())
     {
-      // Cooldown gate
-      if (now < _cooldownLimitMs)
-      {
-        return nullptr;
-      }
-      if (_rfid.PICC_ReadCardSerial())
+      RC522::Uid uid;
+      if (_rfid.readUid(uid))
       {
         _lastGoodReadMs = now;
         _failReadCount = 0;
 
-        update(_rfid.uid, now);
-
-        _rfid.PICC_HaltA();
-        _rfid.PCD_StopCrypto1();
+        const TagPayload* payload = nullptr;
+        if constexpr (Traits::readPayload)
+        {
+          payload = lookupPayload(uid, now); // card is still selected
+        }
+        _rfid.haltA();
+        clearIrq();
 
-        _cooldownLimitMs = now + Traits::cooldownMs;
+        // Cooldown gate, per tag
+        if (!_cooldown.admit(uid.bytes, uid.size, now, Traits::cooldownMs))
+        {
+          return nullptr;
+        }
+        update(uid, now);
+        _lastID._payload = payload;
         return &_lastID;
       }
       else
       {
         Serial.println("RFID: Read Failed");
-        _rfid.PCD_StopCrypto1();
-        _rfid.PICC_HaltA();
+        _rfid.haltA();
+        clearIrq();
         _failReadCount++;
         if (_failReadCount >= Traits::failResetCount)
         {
@@ -90,28 +143,120 @@ public:
   }
 
 private:
-  MFRC522 _rfid;
+  Reader _rfid;
   RFID _lastID;
-  uint32_t _cooldownLimitMs;
+  RFIDCooldown<Traits::cooldownTags> _cooldown;
+  TagPayloadCache<Traits::readPayload ? Traits::payloadTags : 1> _payloads;
   uint32_t _lastGoodReadMs;
   uint8_t  _failReadCount;
+  bool     _sharedReset;
+  bool     _armed = false;
 
-  void update(const MFRC522::Uid& u, uint32_t timestamp)
+  bool cardPresent()
+  {
+    if constexpr (!UseIrq)
+    {
+      return _rfid.requestA();
+    }
+    else
+    {
+      if (!_armed)
+      {
+        armReqa();
+        _armed = true;
+        return false;
+      }
+      _armed = false;
+      if (!RFIDIrqFlag<Traits::IrqPin>::raised.exchange(false))
+      {
+        return false; // timed out, nobody answered
+      }
+      // ATQA is two bytes; anything else is noise. The card is now READY,
+      // so readUid goes straight to anticollision.
+      const uint8_t errors = _rfid.readRegister(RC522::ErrorReg);
+      const uint8_t level = _rfid.readRegister(RC522::FIFOLevelReg);
+      _rfid.writeRegister(RC522::ComIrqReg, 0x7F);
+      return (errors & 0x13) == 0 && level == 2; // ProtocolErr, ParityErr, BufferOvfl
+    }
+  }
+
+  void enableIrq()
+  {
+    _rfid.writeRegister(RC522::ComIEnReg, 0xA0); // IRqInv, RxIEn
+    _rfid.writeRegister(RC522::DivIEnReg, 0x80); // IRQPushPull
+    _armed = false;
+  }
+
+  // Start a REQA without waiting for the answer.
+  void armReqa()
+  {
+    _rfid.writeRegister(RC522::CommandReg, RC522::Idle);
+    _rfid.writeRegister(RC522::ComIrqReg, 0x7F);
+    _rfid.writeRegister(RC522::CollReg, _rfid.readRegister(RC522::CollReg) & 0x7F);
+    _rfid.writeRegister(RC522::FIFOLevelReg, 0x80);
+    _rfid.writeRegister(RC522::FIFODataReg, RC522::REQA);
+    _rfid.writeRegister(RC522::CommandReg, RC522::Transceive);
+    _rfid.writeRegister(RC522::BitFramingReg, 0x87); // StartSend, 7 bit frame
+  }
+
+  // The reader's own exchanges raise RxIRq too.
+  void clearIrq()
+  {
+    if constexpr (UseIrq)
+    {
+      RFIDIrqFlag<Traits::IrqPin>::raised.store(false);
+      _armed = false;
+    }
+  }
+
+  const TagPayload* lookupPayload(const RC522::Uid& uid, uint32_t now)
+  {
+    RFID::ID id{};
+    std::copy(uid.bytes, uid.bytes + uid.size, id.begin());
+    auto& entry = _payloads.lookup(id, now);
+    if (entry.valid) return &entry.payload;
+    if (entry.tries >= Traits::payloadTries) return nullptr;
+    ++entry.tries;
+
+    uint8_t raw[TagPayload::Bytes];
+    const bool classic = RC522::isMifareClassic(uid.sak);
+    if (classic && !_rfid.authenticate(uid, Traits::payloadBlock, Traits::payloadKeyA.data())) return nullptr;
+    for (size_t n = 0; n < TagPayload::Bytes / 16; ++n)
+    {
+      const uint8_t address = classic ? Traits::payloadBlock + n : Traits::payloadPage + 4 * n;
+      if (!_rfid.read16(address, raw + 16 * n)) return nullptr;
+    }
+    if (!TagPayload::decode(raw, entry.payload))
+    {
+      entry.tries = Traits::payloadTries; // readable, just not ours
+      return nullptr;
+    }
+    entry.valid = true;
+    return &entry.payload;
+  }
+
+  void update(const RC522::Uid& u, uint32_t timestamp)
   {
     _lastID._timestamp = timestamp;
+    _lastID._micros = micros();
     const uint8_t len = (u.size > 10) ? 10 : u.size;
     _lastID._length = len;
-    std::copy(u.uidByte, u.uidByte + len, _lastID._uuid.begin());
+    std::copy(u.bytes, u.bytes + len, _lastID._uuid.begin());
   }
 
   void resetRc522()
   {
-    Traits::RstPin::write(GpioLevel::Low);
-    delay(5);
-    Traits::RstPin::write(GpioLevel::High);
-    delay(5);
-    _rfid.PCD_Init();
-    _rfid.PCD_SetAntennaGain(_rfid.RxGain_max);
+    if (!_sharedReset)
+    {
+      Traits::RstPin::write(GpioLevel::Low);
+      delay(5);
+      Traits::RstPin::write(GpioLevel::High);
+      delay(5);
+    }
+    // With RST high init is a soft reset
+    _rfid.init();
+    _rfid.antennaGainMax();
+    if constexpr (UseIrq) enableIrq();
     _failReadCount = 0;
     // Do not reset _lastGoodReadMs
   }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <utility>
+
+#include "../PinIO/TaskThunk.h"
+#include "../ble/IDBTCharacteristic.h"
+#include "RFIDDetector.h"
+
+/*
+Several RC522 readers (approach, platform, exit) on one SPI bus, each with
+its own chip select and a shared RST line, served by one task.
+
+Every tick polls the next reader only, round robin, so CPU time per tick is
+that of a single reader and each reader is polled once every
+perReaderMs = readers * tick, whatever the count. A detection is tagged with
+its reader number (Number + index) and notified on that reader's
+characteristic, writeIndex(bleProperty, number).
+*/
+struct RFIDMultiBroadcasterTraitsDft: RFIDDetectorTraitsDft
+{
+  static constexpr const char* bleProperty = "01000002";
+  static constexpr std::array<uint8_t, 3> SsPins = { 10, 8, 7 };
+  static constexpr uint32_t perReaderMs = 30; // bound on poll latency per reader
+};
+
+template<typename Traits = RFIDMultiBroadcasterTraitsDft>
+class RFIDMultiBroadcaster : ScheduledRunner
+{
+public:
+  using Detector = RFIDDetector<Traits>;
+  using Callback = void (*)(const RFID&);
+
+  static constexpr size_t Readers = Traits::SsPins.size();
+  static constexpr uint32_t TickMs = Traits::perReaderMs / Readers > 0 ? Traits::perReaderMs / Readers : 1;
+
+  static_assert(Readers > 0, "RFIDMultiBroadcaster needs at least one reader");
+  static_assert(!Detector::UseIrq, "Readers share traits, so they cannot have an IRQ line each");
+
+  RFIDMultiBroadcaster(Scheduler& scheduler, BLEServiceRunner& ble, Callback callback = nullptr)
+  : RFIDMultiBroadcaster(scheduler, ble, callback, std::make_index_sequence<Readers>{})
+  {
+  }
+
+  void begin()
+  {
+    // Deselect every reader first; a floating CS would answer on the bus
+    // while another reader initialises.
+    for (uint8_t pin : Traits::SsPins)
+    {
+      pinMode(pin, OUTPUT);
+      digitalWrite(pin, HIGH);
+    }
+    for (Detector& reader : _readers)
+    {
+      reader.begin();
+      Serial.print("RFID: ");
+      reader.lastID().print();
+      Serial.println();
+    }
+  }
+
+  const RFID& lastID(size_t reader) const { return _readers[reader].lastID(); }
+
+private:
+  std::array<Detector, Readers> _readers;
+  std::array<RFID::Encoded, Readers> _initial;
+  Callback _callback;
+  std::array<IDBTCharacteristic, Readers> _idFeedbackChars;
+  TaskThunk _rfidTask;
+  size_t _next = 0;
+
+  template <size_t... I>
+  RFIDMultiBroadcaster(Scheduler& scheduler, BLEServiceRunner& ble, Callback callback, std::index_sequence<I...>)
+  : _readers{ Detector(Traits::Number + I, Traits::SsPins[I], true)... }
+  , _initial{ _readers[I].lastID().encode()... }
+  , _callback(callback)
+  , _idFeedbackChars{ IDBTCharacteristic(ble, writeIndex(Traits::bleProperty, Traits::Number + I).data(), _initial[I])... }
+  , _rfidTask(scheduler, TickMs, this)
+  {
+  }
+
+  virtual void loop(Task&)
+  {
+    const size_t index = _next;
+    _next = (_next + 1) % Readers;
+    const RFID* detected = _readers[index].loop();
+    if (detected)
+    {
+      Serial.print("RFID: ");
+      detected->print();
+      Serial.println();
+      if (_callback) _callback(*detected);
+      auto encoded = detected->encode();
+      _idFeedbackChars[index].writeValue(encoded.data(), detected->encodedSize());
+    }
+  }
+};
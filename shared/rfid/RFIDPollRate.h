@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+
+/*
+Adaptive poll interval for a polled reader. After activity (a detection,
+or wake() from a dock change or an upstream reader) it polls at fastMs for
+holdFastMs, then doubles the interval on every quiet poll up to slowMs.
+expect() schedules a wake leadMs before a predicted arrival, so the reader
+is already fast when the train gets there.
+*/
+struct RFIDPollRateTraitsDft
+{
+  static constexpr uint32_t fastMs     = 20;
+  static constexpr uint32_t slowMs     = 320;
+  static constexpr uint32_t holdFastMs = 5000;
+  static constexpr uint32_t leadMs     = 1000;
+};
+
+template <typename Traits = RFIDPollRateTraitsDft>
+class RFIDPollRate
+{
+public:
+  static_assert(Traits::fastMs > 0 && Traits::fastMs <= Traits::slowMs, "fastMs must be within (0, slowMs]");
+
+  uint32_t interval() const { return _intervalMs; }
+
+  void wake(uint32_t now = millis())
+  {
+    _activityMs = now;
+    _intervalMs = Traits::fastMs;
+  }
+
+  // Arrival predicted in etaMs.
+  void expect(uint32_t etaMs, uint32_t now = millis())
+  {
+    if (etaMs <= Traits::leadMs)
+    {
+      wake(now);
+      return;
+    }
+    _wakeAtMs = now + etaMs - Traits::leadMs;
+    _expecting = true;
+  }
+
+  // Interval until the next poll, given whether this one detected.
+  uint32_t next(bool detected, uint32_t now = millis())
+  {
+    if (_expecting && static_cast<int32_t>(now - _wakeAtMs) >= 0)
+    {
+      _expecting = false;
+      detected = true;
+    }
+    if (detected)
+    {
+      wake(now);
+    }
+    else if (now - _activityMs >= Traits::holdFastMs)
+    {
+      _intervalMs = _intervalMs >= Traits::slowMs / 2 ? Traits::slowMs : _intervalMs * 2;
+    }
+    return due(now);
+  }
+
+  // Interval from now, cut short by a pending expected arrival.
+  uint32_t due(uint32_t now = millis()) const
+  {
+    if (_expecting)
+    {
+      const uint32_t untilWake = _wakeAtMs - now;
+      if (untilWake < _intervalMs) return untilWake < Traits::fastMs ? Traits::fastMs : untilWake;
+    }
+    return _intervalMs;
+  }
+
+private:
+  uint32_t _intervalMs = Traits::fastMs;
+  uint32_t _activityMs = 0;
+  uint32_t _wakeAtMs = 0;
+  bool     _expecting = false;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+/*
+Train metadata written on the sticker, 32 bytes from MIFARE Classic block
+4 (sector 1, key A) or NTAG page 4:
+
+  u8  'T', 'R'
+  u8  version (1)
+  u8  LEGO PF channel
+  u32 logo[3]     little endian, MatrixR4Value::Value words
+  char name[16]   NUL padded
+*/
+struct TagPayload
+{
+  static constexpr size_t  Bytes   = 32;
+  static constexpr uint8_t Version = 1;
+
+  uint8_t pfChannel = 0;
+  std::array<uint32_t, 3> logo{};
+  char name[17] = {};
+
+  static bool decode(const uint8_t* raw, TagPayload& out)
+  {
+    if (raw[0] != 'T' || raw[1] != 'R' || raw[2] != Version) return false;
+    out.pfChannel = raw[3];
+    for (size_t i = 0; i < out.logo.size(); ++i)
+    {
+      const uint8_t* w = raw + 4 + 4 * i;
+      out.logo[i] = uint32_t(w[0]) | (uint32_t(w[1]) << 8) | (uint32_t(w[2]) << 16) | (uint32_t(w[3]) << 24);
+    }
+    std::memcpy(out.name, raw + 16, 16);
+    out.name[16] = '\0';
+    return true;
+  }
+};
+
+/*
+Payloads by UID, so a tag is authenticated and read on first contact only.
+Tags without a payload are remembered too, after maxTries attempts; the
+least recently seen entry makes room for a new tag.
+*/
+template <size_t Capacity>
+class TagPayloadCache
+{
+public:
+  using ID = std::array<uint8_t, 10>;
+
+  struct Entry
+  {
+    ID id;
+    uint32_t lastSeenMs;
+    uint8_t tries;
+    bool used;
+    bool valid;
+    TagPayload payload;
+  };
+
+  Entry& lookup(const ID& id, uint32_t now)
+  {
+    Entry* oldest = &_entries[0];
+    for (Entry& e : _entries)
+    {
+      if (e.used && e.id == id)
+      {
+        e.lastSeenMs = now;
+        return e;
+      }
+      if (!e.used || (oldest->used && now - e.lastSeenMs > now - oldest->lastSeenMs)) oldest = &e;
+    }
+    *oldest = Entry{};
+    oldest->id = id;
+    oldest->lastSeenMs = now;
+    oldest->used = true;
+    return *oldest;
+  }
+
+private:
+  std::array<Entry, Capacity> _entries{};
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+#include "../PinIO/TaskThunk.h"
+#include "RFID.h"
+#include "TrainRegistryStorage.h"
+
+/*
+Known trains by tag UID, with a value per train (e.g. its logo).
+
+Entries stay in insertion order, which is also the stored blob, so boot is
+one read straight into the table. A separate sorted index of entry numbers
+gives binary search lookups; inserting moves index slots only.
+
+set() marks the table dirty; it is written once no change has arrived for
+flushDelayMs, so a burst of edits costs one write.
+*/
+struct TrainRegistryTraitsDft
+{
+  static constexpr size_t   capacity     = 128;
+  static constexpr uint32_t flushDelayMs = 5000;
+  static constexpr uint32_t checkMs      = 500;
+};
+
+template <typename Value, typename Traits = TrainRegistryTraitsDft, typename Storage = TrainRegistryStorageDft>
+class TrainRegistry : ScheduledRunner
+{
+public:
+  struct Entry
+  {
+    RFID::ID id;
+    Value value;
+  };
+
+  TrainRegistry(Scheduler& scheduler, Storage storage = Storage{})
+  : _storage(storage)
+  , _task(scheduler, Traits::checkMs, this, false)
+  {
+  }
+
+  // Loads the stored table; false when there was none.
+  bool begin()
+  {
+    const size_t bytes = _storage.load(_entries.data(), sizeof(_entries));
+    const size_t count = bytes / sizeof(Entry);
+    for (_count = 0; _count < count; ++_count)
+    {
+      const size_t at = lowerBound(_entries[_count].id);
+      std::memmove(&_index[at + 1], &_index[at], (_count - at) * sizeof(_index[0]));
+      _index[at] = static_cast<IndexType>(_count);
+    }
+    return _count > 0;
+  }
+
+  size_t size() const { return _count; }
+
+  const Value* find(const RFID::ID& id) const
+  {
+    const size_t at = lowerBound(id);
+    if (at < _count && _entries[_index[at]].id == id) return &_entries[_index[at]].value;
+    return nullptr;
+  }
+
+  // Insert or update; false when full.
+  bool set(const RFID::ID& id, const Value& value)
+  {
+    const size_t at = lowerBound(id);
+    if (at < _count && _entries[_index[at]].id == id)
+    {
+      _entries[_index[at]].value = value;
+    }
+    else
+    {
+      if (_count == Traits::capacity) return false;
+      _entries[_count] = Entry{ id, value };
+      std::memmove(&_index[at + 1], &_index[at], (_count - at) * sizeof(_index[0]));
+      _index[at] = static_cast<IndexType>(_count);
+      ++_count;
+    }
+    _dirtyMs = millis();
+    _dirty = true;
+    _task.enable();
+    return true;
+  }
+
+  void flush()
+  {
+    if (!_dirty) return;
+    _dirty = false;
+    if (!_storage.save(_entries.data(), _count * sizeof(Entry)))
+    {
+      Serial.println("TrainRegistry: save failed");
+    }
+  }
+
+private:
+  using IndexType = typename std::conditional<(Traits::capacity <= 256), uint8_t, uint16_t>::type;
+
+  Storage _storage;
+  TaskThunk _task;
+  std::array<Entry, Traits::capacity> _entries{};
+  std::array<IndexType, Traits::capacity> _index{};
+  size_t _count = 0;
+  uint32_t _dirtyMs = 0;
+  bool _dirty = false;
+
+  size_t lowerBound(const RFID::ID& id) const
+  {
+    size_t lo = 0;
+    size_t hi = _count;
+    while (lo < hi)
+    {
+      const size_t mid = (lo + hi) / 2;
+      if (_entries[_index[mid]].id < id) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  virtual void loop(Task&) override
+  {
+    if (!_dirty)
+    {
+      _task.disable();
+      return;
+    }
+    if (millis() - _dirtyMs < Traits::flushDelayMs) return;
+    flush();
+    _task.disable();
+  }
+};
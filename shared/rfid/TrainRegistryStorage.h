@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Arduino.h>
+
+/*
+Persistence for TrainRegistry: one blob, loaded with a single read at boot
+and rewritten whole on flush.
+
+  TrainRegistryNvs     ESP32 NVS through Preferences; NVS wear levels itself.
+  TrainRegistryEeprom  EEPROM (R4 data flash) split into banks. Each save
+                       goes to the next bank with a higher generation, data
+                       first and header last, so a torn write leaves the
+                       previous generation intact and wear is spread over
+                       all banks.
+
+Interface: size_t load(void* data, size_t capacity), bool save(const void* data, size_t size).
+*/
+namespace TrainRegistryDetail
+{
+  // FNV-1a, enough to reject a torn or blank bank.
+  inline uint32_t checksum(const uint8_t* data, size_t length)
+  {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+      h ^= data[i];
+      h *= 16777619u;
+    }
+    return h;
+  }
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include <Preferences.h>
+
+class TrainRegistryNvs
+{
+public:
+  TrainRegistryNvs(const char* ns = "trains", const char* key = "registry")
+  : _ns(ns)
+  , _key(key)
+  {
+  }
+
+  size_t load(void* data, size_t capacity)
+  {
+    _prefs.begin(_ns, false);
+    const size_t size = _prefs.getBytesLength(_key);
+    if (size == 0 || size > capacity) return 0;
+    return _prefs.getBytes(_key, data, size);
+  }
+
+  bool save(const void* data, size_t size)
+  {
+    return _prefs.putBytes(_key, data, size) == size;
+  }
+
+private:
+  Preferences _prefs;
+  const char* _ns;
+  const char* _key;
+};
+
+using TrainRegistryStorageDft = TrainRegistryNvs;
+
+#else
+
+#include <EEPROM.h>
+
+template <int Base = 0, size_t Banks = 2, size_t BankBytes = 4096>
+class TrainRegistryEeprom
+{
+public:
+  static constexpr uint32_t Magic = 0x314E5254; // "TRN1"
+
+  size_t load(void* data, size_t capacity)
+  {
+    // Newest valid generation wins; an invalid one falls back to the next.
+    uint32_t tried = 0;
+    for (size_t attempt = 0; attempt < Banks; ++attempt)
+    {
+      int best = -1;
+      Header bestHeader{};
+      for (size_t b = 0; b < Banks; ++b)
+      {
+        if (tried & (1u << b)) continue;
+        Header h;
+        EEPROM.get(address(b), h);
+        if (h.magic != Magic || h.size > capacity || h.size > Payload) continue;
+        if (best < 0 || h.generation > bestHeader.generation)
+        {
+          best = static_cast<int>(b);
+          bestHeader = h;
+        }
+      }
+      if (best < 0) return 0;
+      tried |= 1u << best;
+
+      uint8_t* out = static_cast<uint8_t*>(data);
+      for (size_t i = 0; i < bestHeader.size; ++i) out[i] = EEPROM.read(address(best) + sizeof(Header) + i);
+      if (TrainRegistryDetail::checksum(out, bestHeader.size) == bestHeader.checksum)
+      {
+        _bank = best;
+        _generation = bestHeader.generation;
+        return bestHeader.size;
+      }
+    }
+    return 0;
+  }
+
+  bool save(const void* data, size_t size)
+  {
+    if (size > Payload) return false;
+    const size_t bank = _bank < 0 ? 0 : (static_cast<size_t>(_bank) + 1) % Banks;
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) EEPROM.update(address(bank) + sizeof(Header) + i, in[i]);
+    const Header h{ Magic, _generation + 1, static_cast<uint32_t>(size), TrainRegistryDetail::checksum(in, size) };
+    EEPROM.put(address(bank), h);
+    _bank = static_cast<int>(bank);
+    _generation = h.generation;
+    return true;
+  }
+
+private:
+  struct Header
+  {
+    uint32_t magic;
+    uint32_t generation;
+    uint32_t size;
+    uint32_t checksum;
+  };
+
+  static constexpr size_t Payload = BankBytes - sizeof(Header);
+
+  int _bank = -1;
+  uint32_t _generation = 0;
+
+  static int address(size_t bank) { return Base + static_cast<int>(bank * BankBytes); }
+};
+
+using TrainRegistryStorageDft = TrainRegistryEeprom<>;
+
+#endif
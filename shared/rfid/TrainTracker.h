@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "../ble/IDBTCharacteristic.h"
+#include "RFID.h"
+
+/*
+Velocity and ETA per train from successive tag detections at readers with
+known track positions (readerPositionMm, indexed by reader number).
+
+Each pair of detections of the same tag gives a measured speed over the
+distance between the two readers, timed with the detections' micros().
+An alpha-beta filter in Q8 fixed point smooths that into velocity and
+acceleration; the ETA to the next reader in the direction of travel uses
+the filtered velocity.
+
+On a loop (loopMm > 0) travel is towards increasing positions and wraps;
+passing the same reader again is one lap. On an open line (loopMm = 0)
+the sign of the distance gives the direction.
+
+Estimates go to the callback and are notified as a TrainEstimate, so
+automation can slow a train (LEGO PF) before it reaches the next block.
+*/
+struct TrainTrackerTraitsDft
+{
+  static constexpr const char* bleProperty = "01030002";
+  static constexpr std::array<int32_t, 1> readerPositionMm = { 0 };
+  static constexpr int32_t  loopMm  = 2400;   // track length, 0 for an open line
+  static constexpr size_t   tracks  = 8;      // trains followed at once
+  static constexpr int32_t  alphaQ8 = 128;    // velocity gain, 0.5
+  static constexpr int32_t  betaQ8  = 32;     // acceleration gain, 0.125
+  static constexpr uint32_t staleMs = 60000;  // longer between readers starts over
+};
+
+struct TrainEstimate
+{
+  RFID::ID id;
+  uint8_t  reader;        // last seen at
+  uint8_t  nextReader;    // NoReader when there is none ahead
+  int16_t  velocityMmS;
+  int16_t  accelMmS2;
+  uint16_t eta10Ms;       // to nextReader, 0 when unknown
+};
+
+template <typename Traits = TrainTrackerTraitsDft>
+class TrainTracker
+{
+public:
+  static constexpr uint8_t NoReader = 0xFF;
+  static constexpr size_t Readers = Traits::readerPositionMm.size();
+
+  using Callback = void (*)(const TrainEstimate&);
+
+  TrainTracker(BLEServiceRunner& ble, Callback callback = nullptr)
+  : _callback(callback)
+  , _estimateChar(ble, Traits::bleProperty, TrainEstimate{})
+  {
+  }
+
+  // Feed every detection, from any reader.
+  void detected(const RFID& rfid)
+  {
+    if (rfid._number >= Readers) return;
+    RFID::ID id{};
+    std::copy(rfid._uuid.begin(), rfid._uuid.begin() + rfid._length, id.begin());
+    const uint32_t nowMs = rfid._timestamp;
+    const uint32_t nowUs = rfid._micros;
+
+    Track& t = track(id, nowMs);
+    const bool fresh = t.samples > 0 && nowMs - t.lastMs < Traits::staleMs;
+    if (fresh)
+    {
+      const int64_t dtUs = static_cast<uint32_t>(nowUs - t.lastUs);
+      const int32_t dist = distance(t.reader, rfid._number);
+      if (dtUs > 0 && dist != 0)
+      {
+        const int32_t measured = static_cast<int32_t>((int64_t(dist) * 1000000 * 256) / dtUs);
+        if (t.samples == 1)
+        {
+          t.velocityQ8 = measured;
+          t.accelQ8 = 0;
+          t.samples = 2;
+        }
+        else
+        {
+          const int32_t predicted = t.velocityQ8 + static_cast<int32_t>((int64_t(t.accelQ8) * dtUs) / 1000000);
+          const int32_t residual = measured - predicted;
+          t.velocityQ8 = predicted + (Traits::alphaQ8 * residual) / 256;
+          t.accelQ8 += static_cast<int32_t>((int64_t(Traits::betaQ8) * residual * 1000000 / 256) / dtUs);
+        }
+      }
+    }
+    else
+    {
+      t.samples = 1;
+      t.velocityQ8 = 0;
+      t.accelQ8 = 0;
+    }
+    t.reader = rfid._number;
+    t.lastMs = nowMs;
+    t.lastUs = nowUs;
+
+    publish(t);
+  }
+
+  const TrainEstimate& last() const { return _estimateChar.value(); }
+
+private:
+  struct Track
+  {
+    RFID::ID id;
+    uint32_t lastMs;
+    uint32_t lastUs;
+    int32_t  velocityQ8; // mm/s
+    int32_t  accelQ8;    // mm/s^2
+    uint8_t  reader;
+    uint8_t  samples;    // 0 new, 1 one sighting, 2 filtering
+    bool     used;
+  };
+
+  Callback _callback;
+  IDBTValue<TrainEstimate> _estimateChar;
+  std::array<Track, Traits::tracks> _tracks{};
+
+  // The train's track, or the least recently seen one reused for it.
+  Track& track(const RFID::ID& id, uint32_t nowMs)
+  {
+    Track* oldest = &_tracks[0];
+    for (Track& t : _tracks)
+    {
+      if (t.used && t.id == id) return t;
+      if (!t.used || (oldest->used && nowMs - t.lastMs > nowMs - oldest->lastMs)) oldest = &t;
+    }
+    *oldest = Track{};
+    oldest->id = id;
+    oldest->used = true;
+    return *oldest;
+  }
+
+  static int32_t distance(uint8_t from, uint8_t to)
+  {
+    const int32_t d = Traits::readerPositionMm[to] - Traits::readerPositionMm[from];
+    if constexpr (Traits::loopMm > 0)
+    {
+      const int32_t wrapped = ((d % Traits::loopMm) + Traits::loopMm) % Traits::loopMm;
+      return wrapped == 0 ? Traits::loopMm : wrapped;
+    }
+    return d;
+  }
+
+  static uint8_t nextReader(uint8_t reader, int32_t velocityQ8)
+  {
+    if constexpr (Traits::loopMm > 0)
+    {
+      // Nearest reader ahead; the same reader a lap on if it is the only one.
+      uint8_t next = reader;
+      int32_t best = Traits::loopMm;
+      for (size_t r = 0; r < Readers; ++r)
+      {
+        const int32_t d = distance(reader, static_cast<uint8_t>(r));
+        if (d < best)
+        {
+          best = d;
+          next = static_cast<uint8_t>(r);
+        }
+      }
+      return next;
+    }
+    else
+    {
+      uint8_t next = NoReader;
+      int32_t best = INT32_MAX;
+      for (size_t r = 0; r < Readers; ++r)
+      {
+        const int32_t d = distance(reader, static_cast<uint8_t>(r));
+        if ((velocityQ8 > 0 ? d > 0 : d < 0) && (d < 0 ? -d : d) < best)
+        {
+          best = d < 0 ? -d : d;
+          next = static_cast<uint8_t>(r);
+        }
+      }
+      return next;
+    }
+  }
+
+  void publish(const Track& t)
+  {
+    TrainEstimate e{};
+    e.id = t.id;
+    e.reader = t.reader;
+    e.velocityMmS = clamp16(t.velocityQ8 / 256);
+    e.accelMmS2 = clamp16(t.accelQ8 / 256);
+    e.nextReader = t.samples == 2 ? nextReader(t.reader, t.velocityQ8) : NoReader;
+    if (e.nextReader != NoReader && t.velocityQ8 != 0)
+    {
+      const int64_t d = distance(t.reader, e.nextReader);
+      const int64_t eta = (d * 256 * 100) / t.velocityQ8; // 10 ms units
+      e.eta10Ms = eta > 0xFFFF ? 0xFFFF : eta > 0 ? static_cast<uint16_t>(eta) : 0;
+    }
+    if (_callback) _callback(e);
+    _estimateChar.set(e);
+  }
+
+  static int16_t clamp16(int32_t v)
+  {
+    return static_cast<int16_t>(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v);
+  }
+};
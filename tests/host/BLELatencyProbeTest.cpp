@@ -0,0 +1,161 @@
+// Loopback stand-in for a BLE client: writes go through the ArduinoBLE
+// handlers of BLEWriteRouter into handlers that switch a pin through
+// TracingPinIOBackend, directly or from a later scheduler pass, on the
+// simulated clock. BLELatencyProbe's histograms are checked against the
+// latencies the test scheduled.
+
+#define SBJ_BLE_LATENCY_PROBE 1
+
+#include "ble/BLEWriteRouter.h"
+#include "PinIO/PinIO.h"
+#include "PinIO/TracingPinIOBackend.h"
+#include "HostCheck.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using Stage = BLELatencyProbe::Stage;
+using Out = PinIO<5, GpioMode::DigitalOut, TracingPinIOBackend<>>;
+
+namespace
+{
+  std::mt19937 rng(0xB1E);
+
+  uint32_t between(uint32_t lo, uint32_t hi)
+  {
+    return lo + rng() % (hi - lo + 1);
+  }
+
+  void spend(uint32_t us)
+  {
+    hostClockNs += uint64_t(us) * 1000;
+  }
+
+  // Lighting style: the handler switches the output itself.
+  struct Direct
+  {
+    uint32_t costUs = 0;
+
+    void write(const uint8_t* data, size_t length)
+    {
+      spend(costUs);
+      Out::write(length && data[0] ? GpioLevel::High : GpioLevel::Low);
+    }
+  };
+
+  // Command batch or matrix style: the handler queues, a task applies.
+  struct Deferred
+  {
+    uint32_t costUs = 0;
+    uint32_t workUs = 0;
+    bool pending = false;
+    uint8_t value = 0;
+
+    void write(const uint8_t* data, size_t length)
+    {
+      spend(costUs);
+      value = length ? data[0] : 0;
+      pending = true;
+      SBJ_LATENCY_DEFERRED();
+    }
+
+    void loop()
+    {
+      if (!pending) return;
+      pending = false;
+      SBJ_LATENCY_DISPATCHED();
+      spend(workUs);
+      Out::write(value ? GpioLevel::High : GpioLevel::Low);
+    }
+  };
+
+  template <typename Obj>
+  void call(void* obj, const uint8_t* data, size_t length)
+  {
+    static_cast<Obj*>(obj)->write(data, length);
+  }
+
+  Direct direct;
+  Deferred deferred;
+  BLECharacteristicEventHandler directHandler = nullptr;
+  BLECharacteristicEventHandler deferredHandler = nullptr;
+
+  std::vector<uint32_t> expected[BLELatencyProbe::Stages];
+
+  // One write: stackUs inside the poll before the handler runs, as
+  // BLEServiceRunner brackets BLE.poll(); none for a callback transport.
+  void write(BLECharacteristicEventHandler handler, uint8_t value, bool polled, uint32_t stackUs)
+  {
+    if (polled) SBJ_LATENCY_POLL_BEGIN();
+    spend(stackUs);
+    handler(BLEDevice{}, BLECharacteristic(&value, 1));
+    if (polled) SBJ_LATENCY_POLL_END();
+  }
+
+  void scenario(int writes)
+  {
+    for (int i = 0; i < writes; ++i)
+    {
+      spend(between(1000, 50000)); // the client's gap between writes
+      const bool polled = rng() % 4 != 0;
+      const uint32_t stackUs = polled ? between(20, 600) : 0;
+      const uint8_t value = static_cast<uint8_t>(i & 1);
+      if (rng() % 2)
+      {
+        direct.costUs = between(5, 80);
+        write(directHandler, value, polled, stackUs);
+        const uint32_t span = stackUs + direct.costUs;
+        expected[size_t(Stage::Event)].push_back(span);
+        expected[size_t(Stage::Actuation)].push_back(span);
+      }
+      else
+      {
+        deferred.costUs = between(5, 40);
+        deferred.workUs = between(50, 3000);
+        write(deferredHandler, value, polled, stackUs);
+        const uint32_t waitUs = between(0, 4000); // until the scheduler gets to the task
+        spend(waitUs);
+        deferred.loop();
+        const uint32_t handled = stackUs + deferred.costUs;
+        expected[size_t(Stage::Event)].push_back(handled);
+        expected[size_t(Stage::Dispatch)].push_back(handled + waitUs);
+        expected[size_t(Stage::Actuation)].push_back(handled + waitUs + deferred.workUs);
+      }
+    }
+  }
+
+  // Percentiles are bucket upper bounds: at least the true value, under twice it.
+  void compare(Stage stage)
+  {
+    std::vector<uint32_t> values = expected[size_t(stage)];
+    const BLELatencyProbe::Histogram& h = BLELatencyProbe::histogram(stage);
+    CHECK(h.samples == values.size());
+    if (values.empty()) return;
+    std::sort(values.begin(), values.end());
+    CHECK(h.maxUs == values.back());
+    for (uint8_t pct : { 50, 90, 99 })
+    {
+      const uint32_t truth = values[(values.size() * pct + 99) / 100 - 1];
+      const uint32_t reported = h.percentileUs(pct);
+      CHECK(reported >= truth && reported <= 2 * truth + 1);
+    }
+  }
+}
+
+int main()
+{
+  Out::begin(GpioLevel::Low);
+  BLELatencyProbe::begin();
+  directHandler = BLEWriteRouter::bind(blePropertyKey("00030001"), &direct, &call<Direct>);
+  deferredHandler = BLEWriteRouter::bind(blePropertyKey("00030002"), &deferred, &call<Deferred>);
+  CHECK(directHandler && deferredHandler);
+
+  scenario(5000);
+  compare(Stage::Event);
+  compare(Stage::Dispatch);
+  compare(Stage::Actuation);
+  CHECK(BLEWriteRouter::writes() == 5000);
+  BLELatencyProbe::print();
+  return hostCheckResult("BLELatencyProbe");
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+/*
+Minimal checks for the host tests: CHECK records a failure and carries on (the first few are printed),
+hostCheckResult() is main's return value. Independent of NDEBUG.
+*/
+inline int hostCheckFailures = 0;
+
+#define CHECK(cond) \
+  do \
+  { \
+    if (!(cond)) \
+    { \
+      if (++hostCheckFailures <= 20) std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+inline int hostCheckResult(const char* name)
+{
+  std::printf("%s: %s\n", name, hostCheckFailures == 0 ? "ok" : "FAILED");
+  return hostCheckFailures == 0 ? 0 : 1;
+}
+
+// Wall time of fn() in nanoseconds per iteration.
+template <typename Fn>
+double hostBenchNs(long iterations, Fn&& fn)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) fn(i);
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / double(iterations);
+}
+
+// Keeps a benchmark result alive without printing it.
+template <typename T>
+inline void hostKeep(const T& value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
@@ -0,0 +1,140 @@
+// Every MatrixR4Transitions kind from src to dst, plus per-frame render cost.
+
+#include "display/MatrixR4Transitions.h"
+#include "HostCheck.h"
+
+#include <random>
+#include <vector>
+
+using Value = MatrixR4Transitions::Value;
+using Kind = MatrixR4Transitions::Kind;
+
+namespace
+{
+  std::mt19937 rng(0x4D52);
+
+  const char* const KindNames[] = {
+    "Animate", "Cut", "WipeLeft", "WipeDown", "Dissolve", "ScrollLeft", "ScrollUp", "Sparkle"
+  };
+  static_assert(sizeof(KindNames) / sizeof(KindNames[0]) == size_t(Kind::Count), "one name per kind");
+
+  // Sparse logos, like the train icons, rather than uniform noise.
+  Value randomValue(int density)
+  {
+    Value v{};
+    for (int i = 0; i < MatrixR4TransitionTables::Pixels; ++i)
+    {
+      if (int(rng() % 100) < density) MatrixR4TransitionTables::light(v, i);
+    }
+    return v;
+  }
+
+  std::vector<Value> run(const Value& src, const Value& dst, Kind kind)
+  {
+    MatrixR4Transitions t;
+    t.start(src, dst, kind);
+    std::vector<Value> out;
+    Value frame{};
+    while (t.next(frame))
+    {
+      out.push_back(frame);
+      if (out.size() > 64) break; // a runaway transition fails below
+    }
+    CHECK(!t.active());
+    return out;
+  }
+
+  // Pixels of frame that are in neither src nor dst.
+  bool within(const Value& frame, const Value& src, const Value& dst)
+  {
+    for (size_t w = 0; w < frame.size(); ++w)
+    {
+      if (frame[w] & ~(src[w] | dst[w])) return false;
+    }
+    return true;
+  }
+
+  void everyKind()
+  {
+    for (int round = 0; round < 2000; ++round)
+    {
+      const Value src = randomValue(round % 3 == 0 ? 50 : 15);
+      const Value dst = randomValue(15);
+      for (int k = 0; k < int(Kind::Count); ++k)
+      {
+        const Kind kind = static_cast<Kind>(k);
+        const std::vector<Value> frames = run(src, dst, kind);
+        CHECK(!frames.empty() && MatrixR4Bits::equal(frames.back(), dst));
+
+        const std::vector<Value> same = run(dst, dst, kind);
+        CHECK(same.size() == 1 && MatrixR4Bits::equal(same.back(), dst));
+
+        if (MatrixR4Bits::equal(src, dst)) continue;
+        if (kind == Kind::Animate)
+        {
+          CHECK(frames.size() >= 2 && frames.size() <= size_t(MatrixR4Animator::MaxSteps) + 1);
+          continue;
+        }
+        CHECK(int(frames.size()) == MatrixR4Transitions::frames(kind) + 1);
+        // Masked kinds only choose between src and dst per pixel; scrolls
+        // move pixels and Sparkle toggles some on purpose.
+        if (kind == Kind::WipeLeft || kind == Kind::WipeDown || kind == Kind::Dissolve)
+        {
+          for (const Value& f : frames) CHECK(within(f, src, dst));
+        }
+      }
+    }
+  }
+
+  // From a blank matrix Animate reveals dst through a growing box.
+  void animateReveal()
+  {
+    const Value blank{};
+    for (int round = 0; round < 2000; ++round)
+    {
+      const Value dst = randomValue(round % 2 ? 5 : 30);
+      const std::vector<Value> frames = run(blank, dst, Kind::Animate);
+      if (MatrixR4Bits::empty(dst))
+      {
+        CHECK(frames.size() == 1);
+        continue;
+      }
+      CHECK(frames.size() >= 2 && frames.size() <= size_t(MatrixR4Animator::MaxSteps) + 1);
+      CHECK(MatrixR4Bits::equal(frames.back(), dst));
+      for (size_t i = 0; i < frames.size(); ++i)
+      {
+        CHECK(within(frames[i], blank, dst));
+        if (i > 0) CHECK(MatrixR4Bits::count(frames[i]) >= MatrixR4Bits::count(frames[i - 1]));
+      }
+    }
+  }
+
+  void renderCost()
+  {
+    const Value src = randomValue(20);
+    const Value dst = randomValue(20);
+    std::printf("  ns per frame, start included:\n");
+    for (int k = 0; k < int(Kind::Count); ++k)
+    {
+      const Kind kind = static_cast<Kind>(k);
+      MatrixR4Transitions t;
+      long frames = 0;
+      Value frame{};
+      const double ns = hostBenchNs(200000, [&](long)
+      {
+        t.start(src, dst, kind);
+        while (t.next(frame)) ++frames;
+        hostKeep(frame);
+      });
+      std::printf("    %-10s %7.1f\n", KindNames[k], ns * 200000.0 / double(frames));
+    }
+  }
+}
+
+int main()
+{
+  everyKind();
+  animateReveal();
+  renderCost();
+  return hostCheckResult("MatrixR4Transitions");
+}
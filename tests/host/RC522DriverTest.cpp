@@ -0,0 +1,517 @@
+// RC522Driver against a simulated RC522 and cards: REQA, anticollision and
+// select through the cascade levels, authentication, READ and HLTA, with the
+// SPI traffic and simulated time of each detection.
+
+#include "rfid/RC522Driver.h"
+#include "rfid/TagPayload.h"
+#include "HostCheck.h"
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+using namespace RC522;
+
+namespace
+{
+  // ISO/IEC 14443-A at 106 kbit/s: one bit per 128 carrier cycles, nine bits
+  // per byte with parity, and a frame delay of about 1172 cycles.
+  constexpr uint64_t BitNs = 9440;
+  constexpr uint64_t FrameDelayNs = 86000;
+  // Chip select and SPI.beginTransaction() around each register access;
+  // a few microseconds on the UNO R4, an estimate rather than a measurement.
+  constexpr uint32_t TransactionNs = 2000;
+
+  using Bits = std::vector<uint8_t>; // one bit per entry, LSB first per byte
+
+  void appendBits(Bits& out, const uint8_t* data, size_t bytes, uint8_t lastBits = 0)
+  {
+    for (size_t i = 0; i < bytes; ++i)
+    {
+      const uint8_t count = (i + 1 == bytes && lastBits) ? lastBits : 8;
+      for (uint8_t b = 0; b < count; ++b) out.push_back((data[i] >> b) & 1);
+    }
+  }
+
+  void appendCrc(std::vector<uint8_t>& frame)
+  {
+    const uint16_t crc = crcA(frame.data(), frame.size());
+    frame.push_back(static_cast<uint8_t>(crc));
+    frame.push_back(static_cast<uint8_t>(crc >> 8));
+  }
+
+  uint64_t airNs(size_t bits, size_t bytes)
+  {
+    return (bits + bytes + 2) * BitNs; // parity per byte, start and end of frame
+  }
+
+  // A PICC: IDLE, READY through the cascade levels, ACTIVE once selected,
+  // HALT after HLTA. Anything unexpected sends it back to IDLE, silently.
+  struct SimCard
+  {
+    enum class State : uint8_t { Idle, Ready, Active, Halt };
+
+    std::vector<uint8_t> uid;
+    uint8_t sak = 0x08;
+    std::array<uint8_t, 6> keyA = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    uint8_t memory[256] = {};
+    State state = State::Idle;
+    uint8_t level = 0;
+
+    bool classic() const { return isMifareClassic(sak); }
+    uint8_t levels() const { return uid.size() == 4 ? 1 : uid.size() == 7 ? 2 : 3; }
+
+    // UID bytes of a cascade level and their BCC, CT first when more follow.
+    std::array<uint8_t, 5> cascade(uint8_t n) const
+    {
+      std::array<uint8_t, 5> out{};
+      const bool more = n + 1 < levels();
+      size_t at = n * 3;
+      uint8_t i = 0;
+      if (more) out[i++] = CascadeTag;
+      while (i < 4) out[i++] = uid[at++];
+      out[4] = out[0] ^ out[1] ^ out[2] ^ out[3];
+      return out;
+    }
+
+    // Answer bits to frame, or false for silence.
+    bool respond(const std::vector<uint8_t>& frame, uint8_t txLastBits, bool crypto, Bits& answer)
+    {
+      answer.clear();
+      if (frame.size() == 1 && txLastBits == 7 && frame[0] == REQA)
+      {
+        if (state != State::Idle) return false;
+        state = State::Ready;
+        level = 0;
+        const uint8_t atqa[2] = { static_cast<uint8_t>(uid.size() == 4 ? 0x04 : uid.size() == 7 ? 0x44 : 0x84), 0x00 };
+        appendBits(answer, atqa, 2);
+        return true;
+      }
+      static constexpr uint8_t sel[3] = { SelCL1, SelCL2, SelCL3 };
+      if (state == State::Ready && frame.size() >= 2 && frame[0] == sel[level])
+      {
+        const std::array<uint8_t, 5> cl = cascade(level);
+        if (frame[1] == 0x70 && frame.size() == 9 && txLastBits == 0)
+        {
+          if (crcA(frame.data(), 9) != 0 || !std::equal(cl.begin(), cl.end(), frame.begin() + 2)) return idle();
+          std::vector<uint8_t> reply = { static_cast<uint8_t>(level + 1 < levels() ? 0x04 : sak) };
+          appendCrc(reply);
+          if (++level == levels()) state = State::Active;
+          appendBits(answer, reply.data(), reply.size());
+          return true;
+        }
+        // Anticollision: answer the rest of the level when the known bits match.
+        const size_t known = (size_t(frame[1] >> 4) - 2) * 8 + (frame[1] & 0x0F);
+        if (known >= 40 || (frame[1] & 0x0F) != txLastBits) return idle();
+        Bits mine;
+        appendBits(mine, cl.data(), cl.size());
+        Bits sent;
+        appendBits(sent, frame.data() + 2, frame.size() - 2, txLastBits);
+        if (sent.size() != known || !std::equal(sent.begin(), sent.end(), mine.begin())) return false;
+        answer.assign(mine.begin() + known, mine.end());
+        return true;
+      }
+      if (state == State::Active && frame.size() == 4 && txLastBits == 0 && crcA(frame.data(), 4) == 0)
+      {
+        if (frame[0] == HLTA && frame[1] == 0)
+        {
+          state = State::Halt;
+          return false;
+        }
+        if (frame[0] == Read)
+        {
+          if (classic() && !crypto) return idle();
+          const size_t at = classic() ? frame[1] * 16 : frame[1] * 4;
+          std::vector<uint8_t> reply;
+          for (size_t i = 0; i < 16; ++i) reply.push_back(memory[(at + i) % sizeof(memory)]);
+          appendCrc(reply);
+          appendBits(answer, reply.data(), reply.size());
+          return true;
+        }
+      }
+      return idle();
+    }
+
+    bool idle()
+    {
+      if (state != State::Halt) state = State::Idle;
+      return false;
+    }
+  };
+
+  // The register file, FIFO and timer of an RC522 behind the SPI shim. An
+  // exchange is worked out when StartSend is written and shows up in the
+  // registers once the simulated clock has passed its air time.
+  class SimRc522 : public HostSpiDevice
+  {
+  public:
+    std::vector<SimCard*> field;
+
+    SimRc522() { reset(); }
+
+    void select() override
+    {
+      _first = true;
+    }
+
+    // First byte: address, bit 7 for read. A read clocks out the register
+    // addressed by the previous byte; a write burst keeps the address.
+    uint8_t transfer(uint8_t out) override
+    {
+      if (_first)
+      {
+        _first = false;
+        _read = out & 0x80;
+        _reg = (out >> 1) & 0x3F;
+        if (_read) _next = readReg(_reg);
+        return 0;
+      }
+      if (!_read)
+      {
+        writeReg(_reg, out);
+        return 0;
+      }
+      const uint8_t value = _next;
+      if (out & 0x80) _next = readReg((out >> 1) & 0x3F);
+      return value;
+    }
+
+  private:
+    struct Pending
+    {
+      bool     active = false;
+      uint64_t doneNs = 0;
+      bool     auth = false;
+      bool     answered = false;
+      bool     collision = false;
+      uint8_t  collPos = 0;
+      uint8_t  lastBits = 0;
+      std::vector<uint8_t> data;
+    };
+
+    uint8_t _regs[64] = {};
+    std::deque<uint8_t> _fifo;
+    Pending _pending;
+    bool _first = true;
+    bool _read = false;
+    uint8_t _reg = 0;
+    uint8_t _next = 0;
+
+    void reset()
+    {
+      std::fill(std::begin(_regs), std::end(_regs), 0);
+      _regs[CommandReg] = 0x20;
+      _regs[ControlReg] = 0x10;
+      _regs[CollReg] = 0x80;
+      _regs[TxControlReg] = 0x80;
+      _regs[VersionReg] = 0x92;
+      _fifo.clear();
+      _pending = Pending{};
+    }
+
+    uint64_t timerNs() const
+    {
+      const uint32_t prescaler = (uint32_t(_regs[TModeReg] & 0x0F) << 8) | _regs[TPrescalerReg];
+      const uint32_t reload = (uint32_t(_regs[TReloadRegH]) << 8) | _regs[TReloadRegL];
+      return uint64_t(reload + 1) * (2 * prescaler + 1) * 1000000000ull / 13560000;
+    }
+
+    void update()
+    {
+      if (!_pending.active || hostClockNs < _pending.doneNs) return;
+      _pending.active = false;
+      if (_pending.auth)
+      {
+        if (_pending.answered) _regs[Status2Reg] |= 0x08; // MFCrypto1On
+        _regs[ComIrqReg] |= 0x10;                         // IdleIRq
+        _regs[CommandReg] = Idle;
+        return;
+      }
+      if (!_pending.answered)
+      {
+        _regs[ComIrqReg] |= 0x01; // TimerIRq; Transceive keeps listening
+        return;
+      }
+      for (uint8_t b : _pending.data) _fifo.push_back(b);
+      _regs[ComIrqReg] |= 0x20; // RxIRq
+      _regs[ErrorReg] = _pending.collision ? 0x08 : 0x00;
+      _regs[ControlReg] = static_cast<uint8_t>((_regs[ControlReg] & ~0x07) | _pending.lastBits);
+      _regs[CollReg] = static_cast<uint8_t>(_pending.collision ? (_regs[CollReg] & 0x80) | (_pending.collPos & 0x1F)
+                                                               : _regs[CollReg] | 0x20);
+    }
+
+    uint8_t readReg(uint8_t reg)
+    {
+      update();
+      if (reg == FIFODataReg)
+      {
+        if (_fifo.empty()) return 0;
+        const uint8_t b = _fifo.front();
+        _fifo.pop_front();
+        return b;
+      }
+      if (reg == FIFOLevelReg) return static_cast<uint8_t>(_fifo.size());
+      return _regs[reg];
+    }
+
+    void writeReg(uint8_t reg, uint8_t value)
+    {
+      update();
+      switch (reg)
+      {
+        case CommandReg:
+          if ((value & 0x0F) == SoftReset)
+          {
+            reset();
+            _regs[CommandReg] = Idle;
+            return;
+          }
+          _regs[CommandReg] = value & 0x3F;
+          if ((value & 0x0F) == Idle) _pending.active = false;
+          if ((value & 0x0F) == MFAuthent) authenticate();
+          return;
+        case ComIrqReg:
+          if (value & 0x80) _regs[ComIrqReg] |= value & 0x7F;
+          else _regs[ComIrqReg] &= ~value;
+          return;
+        case FIFOLevelReg:
+          if (value & 0x80) _fifo.clear();
+          return;
+        case FIFODataReg:
+          if (_fifo.size() < 64) _fifo.push_back(value);
+          return;
+        case BitFramingReg:
+          _regs[BitFramingReg] = value & 0x7F;
+          if ((value & 0x80) && (_regs[CommandReg] & 0x0F) == Transceive) transceive(value & 0x07, (value >> 4) & 0x07);
+          return;
+        default:
+          _regs[reg] = value;
+      }
+    }
+
+    // Every card in the field hears the frame; differing answer bits collide
+    // and read as 1. CollPos counts from bit 0 of the first received byte.
+    void transceive(uint8_t txLastBits, uint8_t rxAlign)
+    {
+      const std::vector<uint8_t> frame(_fifo.begin(), _fifo.end());
+      _fifo.clear();
+      const bool crypto = _regs[Status2Reg] & 0x08;
+      Bits merged;
+      bool answered = false;
+      size_t collision = SIZE_MAX;
+      for (SimCard* card : field)
+      {
+        Bits answer;
+        if (!card->respond(frame, txLastBits, crypto, answer)) continue;
+        if (!answered) merged = answer;
+        for (size_t i = 0; answered && i < std::min(merged.size(), answer.size()); ++i)
+        {
+          if (merged[i] != answer[i] && collision == SIZE_MAX) collision = i;
+          merged[i] |= answer[i];
+        }
+        answered = true;
+      }
+
+      const size_t sentBits = txLastBits ? (frame.size() - 1) * 8 + txLastBits : frame.size() * 8;
+      const uint64_t txNs = airNs(sentBits, frame.size());
+      _pending = Pending{};
+      _pending.active = true;
+      _pending.answered = answered;
+      if (!answered)
+      {
+        _pending.doneNs = hostClockNs + txNs + timerNs();
+        return;
+      }
+      const size_t total = rxAlign + merged.size();
+      _pending.data.assign((total + 7) / 8, 0);
+      for (size_t i = 0; i < merged.size(); ++i)
+      {
+        _pending.data[(rxAlign + i) / 8] |= static_cast<uint8_t>(merged[i] << ((rxAlign + i) % 8));
+      }
+      _pending.lastBits = static_cast<uint8_t>(total % 8);
+      _pending.collision = collision != SIZE_MAX;
+      _pending.collPos = static_cast<uint8_t>(rxAlign + collision + 1);
+      _pending.doneNs = hostClockNs + txNs + FrameDelayNs + airNs(merged.size(), merged.size() / 8);
+    }
+
+    // Three-pass Crypto1 authentication, reduced to its outcome and air time.
+    void authenticate()
+    {
+      const std::vector<uint8_t> frame(_fifo.begin(), _fifo.end());
+      _fifo.clear();
+      _pending = Pending{};
+      _pending.active = true;
+      _pending.auth = true;
+      _pending.doneNs = hostClockNs + 3 * FrameDelayNs + airNs(18 * 8, 18);
+      if (frame.size() != 12 || frame[0] != MFAuthKeyA) return;
+      for (SimCard* card : field)
+      {
+        if (card->state != SimCard::State::Active || !card->classic()) continue;
+        const bool key = std::equal(card->keyA.begin(), card->keyA.end(), frame.begin() + 2);
+        const bool uid = std::equal(card->uid.end() - 4, card->uid.end(), frame.begin() + 8);
+        _pending.answered = key && uid;
+      }
+    }
+  };
+
+  SimRc522 chip;
+  RC522Driver<> driver(10, 9);
+
+  struct Cost
+  {
+    uint32_t transactions;
+    uint32_t bytes;
+    double   us;
+  };
+
+  template <typename Fn>
+  Cost measure(Fn&& fn)
+  {
+    SPI.transactions = 0;
+    SPI.bytes = 0;
+    const uint64_t start = hostClockNs;
+    fn();
+    return Cost{ SPI.transactions, SPI.bytes, double(hostClockNs - start) / 1000.0 };
+  }
+
+  void report(const char* name, const Cost& cost)
+  {
+    const double spiUs = double(cost.bytes) * 8.0 / (RC522DriverTraitsDft::spiHz / 1000000.0);
+    std::printf("    %-30s %4u %6u %9.1f %9.1f\n", name, unsigned(cost.transactions), unsigned(cost.bytes),
+                spiUs, cost.us);
+  }
+
+  void place(std::vector<SimCard*> cards)
+  {
+    for (SimCard* card : cards) card->state = SimCard::State::Idle;
+    chip.field = std::move(cards);
+  }
+
+  SimCard card(std::vector<uint8_t> uid, uint8_t sak)
+  {
+    SimCard c;
+    c.uid = std::move(uid);
+    c.sak = sak;
+    for (size_t i = 0; i < sizeof(c.memory); ++i) c.memory[i] = static_cast<uint8_t>(i * 7 + 3);
+    return c;
+  }
+
+  bool sameUid(const Uid& uid, const SimCard& c)
+  {
+    return uid.size == c.uid.size() && std::equal(c.uid.begin(), c.uid.end(), uid.bytes);
+  }
+
+  // REQA, anticollision and select, HLTA: one polled detection.
+  bool detect(Uid& uid)
+  {
+    if (!driver.requestA()) return false;
+    const bool ok = driver.readUid(uid);
+    driver.haltA();
+    return ok;
+  }
+
+  void init()
+  {
+    SPI.device = &chip;
+    SPI.transactionNs = TransactionNs;
+    driver.init();
+    CHECK(driver.readRegister(VersionReg) == 0x92);
+  }
+
+  void detections()
+  {
+    std::printf("  per detection:                 trans  bytes   SPI us  total us\n");
+    Uid uid;
+
+    place({});
+    report("empty field (REQA timeout)", measure([&] { CHECK(!driver.requestA()); }));
+
+    SimCard classic = card({ 0x3A, 0x91, 0x0C, 0x7E }, 0x08);
+    place({ &classic });
+    report("1K, 4 byte UID", measure([&] { CHECK(detect(uid) && sameUid(uid, classic) && uid.sak == 0x08); }));
+    CHECK(classic.state == SimCard::State::Halt);
+    CHECK(!driver.requestA()); // halted cards stay quiet
+
+    SimCard ntag = card({ 0x04, 0x5C, 0x21, 0x9A, 0x6B, 0x70, 0x80 }, 0x00);
+    place({ &ntag });
+    report("NTAG, 7 byte UID", measure([&] { CHECK(detect(uid) && sameUid(uid, ntag) && uid.sak == 0x00); }));
+
+    SimCard big = card({ 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA }, 0x20);
+    place({ &big });
+    report("10 byte UID", measure([&] { CHECK(detect(uid) && sameUid(uid, big)); }));
+
+    // Three 1K cards with first UID bytes 0x01, 0x09 and 0x49: collisions at
+    // bits 3 and then 6 of the first byte, resolved towards the bit set, and
+    // one fewer card to tell apart on each detection after that.
+    SimCard a = card({ 0x01, 0x02, 0x03, 0x04 }, 0x08);
+    SimCard b = card({ 0x09, 0x02, 0x03, 0x04 }, 0x08);
+    SimCard c = card({ 0x49, 0x02, 0x03, 0x04 }, 0x08);
+    place({ &a, &b, &c });
+    report("three cards, two collisions", measure([&] { CHECK(detect(uid) && sameUid(uid, c)); }));
+    report("two cards, one collision", measure([&] { CHECK(detect(uid) && sameUid(uid, b)); }));
+    report("last card", measure([&] { CHECK(detect(uid) && sameUid(uid, a)); }));
+    CHECK(!driver.requestA());
+  }
+
+  void payloads()
+  {
+    std::printf("  payload (%zu bytes), card selected:\n", TagPayload::Bytes);
+    Uid uid;
+    uint8_t raw[16];
+
+    SimCard ntag = card({ 0x04, 0x5C, 0x21, 0x9A, 0x6B, 0x70, 0x80 }, 0x00);
+    place({ &ntag });
+    CHECK(driver.requestA() && driver.readUid(uid));
+    report("NTAG, READ pages 4 and 8", measure([&]
+    {
+      for (uint8_t page = 4; page < 4 + TagPayload::Bytes / 4; page += 4)
+      {
+        CHECK(driver.read16(page, raw) && std::equal(raw, raw + 16, ntag.memory + page * 4));
+      }
+    }));
+    driver.haltA();
+
+    SimCard classic = card({ 0x3A, 0x91, 0x0C, 0x7E }, 0x08);
+    place({ &classic });
+    CHECK(driver.requestA() && driver.readUid(uid));
+    CHECK(!driver.read16(4, raw)); // not authenticated
+    driver.haltA();
+    place({ &classic });
+    CHECK(driver.requestA() && driver.readUid(uid));
+    report("1K, auth + READ blocks 4, 5", measure([&]
+    {
+      CHECK(driver.authenticate(uid, 4, classic.keyA.data()));
+      for (uint8_t block = 4; block < 4 + TagPayload::Bytes / 16; ++block)
+      {
+        CHECK(driver.read16(block, raw) && std::equal(raw, raw + 16, classic.memory + block * 16));
+      }
+    }));
+    driver.haltA();
+
+    const uint8_t wrong[6] = { 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5 };
+    place({ &classic });
+    CHECK(driver.requestA() && driver.readUid(uid));
+    CHECK(!driver.authenticate(uid, 4, wrong));
+    driver.haltA();
+  }
+
+  void parts()
+  {
+    std::printf("  parts, 4 byte UID:\n");
+    Uid uid;
+    SimCard classic = card({ 0x3A, 0x91, 0x0C, 0x7E }, 0x08);
+    place({ &classic });
+    report("requestA", measure([&] { CHECK(driver.requestA()); }));
+    report("readUid", measure([&] { CHECK(driver.readUid(uid)); }));
+    report("haltA (waits for the timeout)", measure([&] { driver.haltA(); }));
+  }
+}
+
+int main()
+{
+  init();
+  detections();
+  payloads();
+  parts();
+  return hostCheckResult("RC522Driver");
+}
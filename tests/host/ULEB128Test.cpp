@@ -0,0 +1,174 @@
+// Round trip fuzz, rejection cases and throughput for ULEB128.h.
+
+#include "ULEB128.h"
+#include "HostCheck.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace ULEB128;
+
+namespace
+{
+  std::mt19937_64 rng(0x5EB128);
+
+  // Values of every encoded length, not just the long ones a uniform draw gives.
+  uint64_t anyValue()
+  {
+    return rng() >> (rng() % 64);
+  }
+
+  void roundTrip()
+  {
+    uint8_t buf[kMaxBytes64];
+    for (int i = 0; i < 1000000; ++i)
+    {
+      const uint64_t v = anyValue();
+      size_t n = encodeU64(v, buf, sizeof(buf));
+      CHECK(n == sizeU64(v));
+      uint64_t d64 = 0;
+      CHECK(decodeU64(buf, n, d64) == n && d64 == v);
+      CHECK(decodeU64(buf, n - 1, d64) == 0); // truncated
+
+      const int64_t s = (rng() & 1) ? -int64_t(v >> 1) : int64_t(v >> 1);
+      n = encodeS64(s, buf, sizeof(buf));
+      int64_t ds64 = 0;
+      CHECK(decodeS64(buf, n, ds64) == n && ds64 == s);
+
+      const uint32_t v32 = static_cast<uint32_t>(v);
+      n = encodeU32(v32, buf, kMaxBytes32);
+      uint32_t d32 = 0;
+      CHECK(n != 0 && decodeU32(buf, n, d32) == n && d32 == v32);
+
+      const int32_t s32 = static_cast<int32_t>(rng());
+      n = encodeS32(s32, buf, kMaxBytes32);
+      int32_t ds32 = 0;
+      CHECK(n != 0 && decodeS32(buf, n, ds32) == n && ds32 == s32);
+    }
+  }
+
+  // Random input never reads past length and only accepts what re-encodes identically.
+  void garbage()
+  {
+    uint8_t buf[kMaxBytes64 + 2];
+    uint8_t again[kMaxBytes64];
+    for (int i = 0; i < 1000000; ++i)
+    {
+      for (uint8_t& b : buf) b = static_cast<uint8_t>(rng() & ((rng() & 1) ? 0xFF : 0x81));
+      const size_t length = rng() % sizeof(buf);
+      uint64_t v = 0;
+      const size_t n = decodeU64(buf, length, v);
+      CHECK(n <= length);
+      if (n)
+      {
+        CHECK(encodeU64(v, again, sizeof(again)) == n && std::equal(buf, buf + n, again));
+      }
+      uint32_t v32 = 0;
+      const size_t n32 = decodeU32(buf, length, v32);
+      CHECK(n32 <= length && n32 <= kMaxBytes32);
+      if (n32)
+      {
+        CHECK(encodeU32(v32, again, sizeof(again)) == n32 && std::equal(buf, buf + n32, again));
+      }
+    }
+  }
+
+  void rejects()
+  {
+    uint64_t v = 0;
+    uint32_t v32 = 0;
+
+    // Non-minimal: a zero final byte after the first, at every position.
+    for (size_t len = 2; len <= kMaxBytes64; ++len)
+    {
+      std::vector<uint8_t> in(len, 0x80);
+      in[0] = 0x81;
+      in[len - 1] = 0x00;
+      CHECK(decodeU64(in.data(), len, v) == 0);
+      if (len <= kMaxBytes32) CHECK(decodeU32(in.data(), len, v32) == 0);
+    }
+    const uint8_t zero[] = { 0x00 };
+    CHECK(decodeU64(zero, 1, v) == 1 && v == 0);
+
+    // Overflow: bits past the target width in the last byte.
+    const uint8_t max32[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x0F };
+    CHECK(decodeU32(max32, 5, v32) == 5 && v32 == 0xFFFFFFFFu);
+    const uint8_t over32[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x1F };
+    CHECK(decodeU32(over32, 5, v32) == 0);
+    const uint8_t max64[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 };
+    CHECK(decodeU64(max64, 10, v) == 10 && v == ~0ull);
+    const uint8_t over64[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02 };
+    CHECK(decodeU64(over64, 10, v) == 0);
+
+    // Overlong: a continuation bit on the last allowed byte.
+    const uint8_t long32[] = { 0x80, 0x80, 0x80, 0x80, 0x81, 0x00 };
+    CHECK(decodeU32(long32, sizeof(long32), v32) == 0);
+    const uint8_t long64[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x81, 0x00 };
+    CHECK(decodeU64(long64, sizeof(long64), v) == 0);
+
+    // Encoders refuse rather than truncate.
+    uint8_t buf[kMaxBytes64];
+    CHECK(encodeU64(~0ull, buf, kMaxBytes64 - 1) == 0);
+    CHECK(encodeU64(300, buf, 1) == 0);
+  }
+
+  void deltaStream()
+  {
+    static uint8_t stream[4096];
+    DeltaWriter<3> writer(stream, sizeof(stream));
+    std::vector<std::pair<uint32_t, DeltaWriter<3>::Sample>> samples;
+    uint32_t t = 1000;
+    DeltaWriter<3>::Sample s{ 500, 0, -980 };
+    while (writer.append(t, s))
+    {
+      samples.push_back({ t, s });
+      t += 20 + rng() % 3;
+      for (int32_t& c : s) c += static_cast<int32_t>(rng() % 9) - 4;
+    }
+    DeltaReader<3> reader(writer.data(), writer.size());
+    uint32_t rt = 0;
+    DeltaReader<3>::Sample rs{};
+    size_t k = 0;
+    while (reader.next(rt, rs))
+    {
+      CHECK(k < samples.size() && rt == samples[k].first && rs == samples[k].second);
+      ++k;
+    }
+    CHECK(k == samples.size());
+    std::printf("  delta stream: %zu samples in %zu bytes, %.2f B/sample (16 raw)\n",
+                k, writer.size(), double(writer.size()) / double(k));
+  }
+
+  void throughput()
+  {
+    uint8_t buf[kMaxBytes64];
+    uint64_t sum = 0;
+    const double small = hostBenchNs(20000000, [&](long i)
+    {
+      const size_t n = encodeU32(static_cast<uint32_t>(i & 0x3FFF), buf, kMaxBytes32);
+      uint32_t d = 0;
+      decodeU32(buf, n, d);
+      sum += d;
+    });
+    const double wide = hostBenchNs(20000000, [&](long i)
+    {
+      const size_t n = encodeU64(uint64_t(i) * 0x9E3779B97F4A7C15ull, buf, kMaxBytes64);
+      uint64_t d = 0;
+      decodeU64(buf, n, d);
+      sum += d;
+    });
+    hostKeep(sum);
+    std::printf("  encode+decode: %.2f ns (1-2 bytes), %.2f ns (up to 10 bytes)\n", small, wide);
+  }
+}
+
+int main()
+{
+  roundTrip();
+  garbage();
+  rejects();
+  deltaStream();
+  throughput();
+  return hostCheckResult("ULEB128");
+}
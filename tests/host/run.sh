@@ -0,0 +1,13 @@
+#!/bin/sh
+# Build and run every host test. Needs a C++17 g++ or clang++ (CXX).
+set -e
+here=$(cd "$(dirname "$0")" && pwd)
+out=${TMPDIR:-/tmp}/sbj-host-tests
+mkdir -p "$out"
+status=0
+for test in "$here"/*Test.cpp; do
+  name=$(basename "$test" .cpp)
+  ${CXX:-g++} -std=c++17 -O2 -Wall -I"$here/shim" -I"$here/../../shared" "$test" -o "$out/$name"
+  "$out/$name" || status=1
+done
+exit $status
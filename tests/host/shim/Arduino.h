@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/*
+Just enough of Arduino.h for the drivers under test. Time is simulated:
+hostClockNs only moves when a test, delay() or a shim device advances it,
+so timeouts and bus costs come out the same on every run.
+*/
+inline uint64_t hostClockNs = 0;
+
+// As the Arduino builds define it, so PinIO picks ArduinoGpioBackend.
+#ifndef ARDUINO
+  #define ARDUINO 10819
+#endif
+
+constexpr uint8_t LOW = 0;
+constexpr uint8_t HIGH = 1;
+constexpr uint8_t INPUT = 0;
+constexpr uint8_t OUTPUT = 1;
+constexpr uint8_t INPUT_PULLUP = 2;
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+inline int analogRead(uint8_t) { return 0; }
+inline void analogWrite(uint8_t, int) {}
+
+inline uint32_t micros() { return static_cast<uint32_t>(hostClockNs / 1000); }
+inline uint32_t millis() { return static_cast<uint32_t>(hostClockNs / 1000000); }
+inline void delay(uint32_t ms) { hostClockNs += uint64_t(ms) * 1000000; }
+inline void delayMicroseconds(uint32_t us) { hostClockNs += uint64_t(us) * 1000; }
+
+// Serial output goes to stdout.
+class Print
+{
+public:
+  size_t print(const char* s) { return size_t(std::printf("%s", s)); }
+  size_t print(int v) { return size_t(std::printf("%d", v)); }
+  size_t print(unsigned int v) { return size_t(std::printf("%u", v)); }
+  size_t print(long v) { return size_t(std::printf("%ld", v)); }
+  size_t print(unsigned long v) { return size_t(std::printf("%lu", v)); }
+
+  size_t println() { return print("\n"); }
+
+  template <typename T>
+  size_t println(T v) { return print(v) + println(); }
+};
+
+class HardwareSerial : public Print {};
+
+inline HardwareSerial Serial;
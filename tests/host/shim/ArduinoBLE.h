@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Arduino.h"
+
+/*
+The part of ArduinoBLE that BLEWriteRouter's handlers see. A test delivers
+a write by calling a bound handler with a characteristic holding the bytes.
+*/
+class BLEDevice {};
+
+class BLECharacteristic
+{
+public:
+  BLECharacteristic(const uint8_t* data = nullptr, int length = 0) : _data(data), _length(length) {}
+
+  const uint8_t* value() const { return _data; }
+  int valueLength() const { return _length; }
+
+private:
+  const uint8_t* _data;
+  int _length;
+};
+
+using BLECharacteristicEventHandler = void (*)(BLEDevice, BLECharacteristic);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Arduino.h"
+
+/*
+SPI stand-in. A transaction selects the device the test installed and each
+transfer is one byte to it; both are counted, and the simulated clock
+advances by the bit time at the transaction's clock plus transactionNs for
+the chip select and bus setup around it.
+*/
+constexpr uint8_t MSBFIRST = 1;
+constexpr uint8_t SPI_MODE0 = 0;
+
+struct HostSpiDevice
+{
+  virtual ~HostSpiDevice() = default;
+  virtual void select() {}
+  virtual uint8_t transfer(uint8_t out) = 0;
+  virtual void deselect() {}
+};
+
+struct SPISettings
+{
+  SPISettings(uint32_t clock = 4000000, uint8_t = MSBFIRST, uint8_t = SPI_MODE0) : clock(clock) {}
+  uint32_t clock;
+};
+
+class SPIClass
+{
+public:
+  HostSpiDevice* device = nullptr;
+  uint32_t transactionNs = 0;
+  uint32_t transactions = 0;
+  uint32_t bytes = 0;
+
+  void begin() {}
+
+  void beginTransaction(const SPISettings& settings)
+  {
+    _clock = settings.clock;
+    ++transactions;
+    hostClockNs += transactionNs;
+    if (device) device->select();
+  }
+
+  uint8_t transfer(uint8_t out)
+  {
+    ++bytes;
+    hostClockNs += 8000000000ull / _clock;
+    return device ? device->transfer(out) : 0;
+  }
+
+  void endTransaction()
+  {
+    if (device) device->deselect();
+  }
+
+private:
+  uint32_t _clock = 4000000;
+};
+
+inline SPIClass SPI;